@@ -0,0 +1,574 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+#include <zdict.h>
+
+#include "catalog_pack.h"
+#include "custom_exceptions.h"
+#include "db.h"
+#include "little_endian.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+// zstd skips frames starting with this, so the header does not disturb
+// tools that only see a zstd stream
+const uint32_t SKIPPABLE_MAGIC = 0x184D2A50;
+const char PACK_MAGIC[4] = {'C', 'N', 'F', 'P'};
+const uint32_t PACK_VERSION = 1;
+
+// magic and size of the skippable frame, magic, version, frame and
+// dictionary size of the header and per frame its sizes and section
+const size_t FRAME_HEADER_SIZE = 8;
+const size_t HEADER_FIELDS_SIZE = 16;
+const size_t FRAME_ENTRY_SIZE = 12;
+
+const size_t DICTIONARY_SIZE = 32 << 10;
+// the records sampled for training the dictionary
+const size_t TRAINING_BYTES = 8 << 20;
+// packs are written once and fetched by every client
+const int COMPRESSION_LEVEL = 19;
+
+const size_t READ_BLOCK_SIZE = 1 << 16;
+
+// the sections an installed catalog holds, a catalog without it holds all
+const char SECTIONS_KEY[] = "@sections";
+
+// with the terminating NUL, like the keys of TdbDatabase
+TDB_DATA sections_key() {
+    TDB_DATA key;
+    key.dptr =
+        reinterpret_cast<unsigned char*>(const_cast<char*>(SECTIONS_KEY));
+    key.dsize = sizeof(SECTIONS_KEY);
+    return key;
+}
+
+struct Record {
+    string key;
+    string value;
+};
+
+int collect_record(TDB_CONTEXT* /*tdb*/,
+                   TDB_DATA key,
+                   TDB_DATA value,
+                   void* records) {
+    static_cast<vector<Record>*>(records)->push_back(
+        Record{string(reinterpret_cast<const char*>(key.dptr), key.dsize),
+               string(reinterpret_cast<const char*>(value.dptr),
+                      value.dsize)});
+    return 0;
+}
+
+// keys are stored with their terminating NUL
+string key_name(const string& key) {
+    return string(key.c_str(), strnlen(key.c_str(), key.size()));
+}
+
+// "<package>-files", which may also be the name of a command; those have
+// no "<package>-version" next to them
+bool is_file_list(const string& name, const unordered_set<string>& names) {
+    static const string suffix = "-files";
+    if (name.size() <= suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) !=
+            0) {
+        return false;
+    }
+    return names.count(name.substr(0, name.size() - suffix.size()) +
+                       "-version") != 0;
+}
+
+[[noreturn]] void throw_pack_error(const boost::locale::message& message,
+                                   const bf::path& path,
+                                   const DatabaseError code = IO_ERROR) {
+    throw DatabaseException(code,
+                            (format(message.str()) % path.string()).str());
+}
+
+string train_dictionary(const vector<Record>& records) {
+    string samples;
+    vector<size_t> sizes;
+    for (const auto& record : records) {
+        if (samples.size() >= TRAINING_BYTES) {
+            break;
+        }
+        samples += record.key;
+        samples += record.value;
+        sizes.push_back(record.key.size() + record.value.size());
+    }
+
+    string dictionary(DICTIONARY_SIZE, '\0');
+    const size_t size =
+        ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(),
+                              samples.data(), sizes.data(),
+                              static_cast<unsigned>(sizes.size()));
+    // too few records to learn from, the frames do without
+    if (ZDICT_isError(size)) {
+        return string();
+    }
+    dictionary.resize(size);
+    return dictionary;
+}
+
+}  // namespace
+
+size_t PackHeader::parse(const string& data) {
+    m_frames.clear();
+    m_dictionary.clear();
+
+    if (data.size() < FRAME_HEADER_SIZE) {
+        return FRAME_HEADER_SIZE;
+    }
+    if (get_u32(data.data()) != SKIPPABLE_MAGIC) {
+        return 0;
+    }
+    const uint64_t size =
+        FRAME_HEADER_SIZE + static_cast<uint64_t>(get_u32(data.data() + 4));
+    if (data.size() < size) {
+        return size;
+    }
+
+    const char* fields = data.data() + FRAME_HEADER_SIZE;
+    if (size < FRAME_HEADER_SIZE + HEADER_FIELDS_SIZE ||
+        memcmp(fields, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 ||
+        get_u32(fields + 4) != PACK_VERSION) {
+        return 0;
+    }
+    const uint64_t count = get_u32(fields + 8);
+    const uint64_t dictionary = get_u32(fields + 12);
+    if (FRAME_HEADER_SIZE + HEADER_FIELDS_SIZE + count * FRAME_ENTRY_SIZE +
+            dictionary !=
+        size) {
+        return 0;
+    }
+
+    uint64_t offset = size;
+    const char* entry = fields + HEADER_FIELDS_SIZE;
+    for (uint64_t i = 0; i < count; ++i, entry += FRAME_ENTRY_SIZE) {
+        const uint32_t section = get_u32(entry + 8);
+        PackFrame frame;
+        frame.offset = offset;
+        frame.compressed = get_u32(entry);
+        frame.size = get_u32(entry + 4);
+        frame.section = static_cast<PackSection>(section);
+        // the installer allocates the sizes of a frame, they come from the
+        // network
+        if ((section != PACK_COMMANDS && section != PACK_FILES) ||
+            frame.size > PACK_FRAME_SIZE + PACK_RECORD_SIZE ||
+            frame.compressed > ZSTD_compressBound(frame.size)) {
+            m_frames.clear();
+            return 0;
+        }
+        m_frames.push_back(frame);
+        offset += frame.compressed;
+    }
+    m_dictionary.assign(entry, dictionary);
+    return size;
+}
+
+pair<uint64_t, uint64_t> PackHeader::range(const unsigned sections) const {
+    pair<uint64_t, uint64_t> result(0, 0);
+    for (const auto& frame : m_frames) {
+        if ((frame.section & sections) == 0) {
+            continue;
+        }
+        if (result.first == result.second) {
+            result.first = frame.offset;
+        }
+        result.second = frame.offset + frame.compressed;
+    }
+    return result;
+}
+
+PackStats write_catalog_pack(const bf::path& catalog, const bf::path& pack) {
+    TDB_CONTEXT* tdb = tdb_open(catalog.c_str(), 512, 0, O_RDONLY, 0);
+    if (tdb == nullptr) {
+        throw_pack_error(translate("Error opening tdb database: %s"), catalog,
+                         CONNECT_ERROR);
+    }
+    vector<Record> records;
+    const bool read = tdb_traverse_read(tdb, collect_record, &records) >= 0;
+    tdb_close(tdb);
+    if (!read) {
+        throw_pack_error(translate("could not read the records of %s"),
+                         catalog);
+    }
+
+    // a catalog installed from a pack is published as a whole
+    records.erase(remove_if(records.begin(), records.end(),
+                            [](const Record& record) {
+                                return key_name(record.key) == SECTIONS_KEY;
+                            }),
+                  records.end());
+    unordered_set<string> names;
+    for (const auto& record : records) {
+        if (record.key.size() + record.value.size() > PACK_RECORD_SIZE) {
+            throw_pack_error(translate("a record of %s is too large"),
+                             catalog);
+        }
+        names.insert(key_name(record.key));
+    }
+    // the file lists go last, the order within a section only makes the
+    // pack reproducible
+    sort(records.begin(), records.end(),
+         [&names](const Record& lhs, const Record& rhs) {
+             const bool lhs_files = is_file_list(key_name(lhs.key), names);
+             const bool rhs_files = is_file_list(key_name(rhs.key), names);
+             if (lhs_files != rhs_files) {
+                 return rhs_files;
+             }
+             return lhs.key < rhs.key;
+         });
+
+    const string dictionary = train_dictionary(records);
+
+    unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> context(ZSTD_createCCtx(),
+                                                          ZSTD_freeCCtx);
+    unique_ptr<ZSTD_CDict, size_t (*)(ZSTD_CDict*)> cdict(nullptr,
+                                                          ZSTD_freeCDict);
+    ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel,
+                           COMPRESSION_LEVEL);
+    ZSTD_CCtx_setParameter(context.get(), ZSTD_c_checksumFlag, 1);
+    if (!dictionary.empty()) {
+        cdict.reset(ZSTD_createCDict(dictionary.data(), dictionary.size(),
+                                     COMPRESSION_LEVEL));
+        ZSTD_CCtx_refCDict(context.get(), cdict.get());
+    }
+
+    PackStats stats;
+    string table;
+    string frames;
+    string buffer;
+    string compressed;
+    PackSection section = PACK_COMMANDS;
+    const auto compress = [&]() {
+        if (buffer.empty()) {
+            return;
+        }
+        compressed.resize(ZSTD_compressBound(buffer.size()));
+        const size_t size =
+            ZSTD_compress2(context.get(), &compressed[0], compressed.size(),
+                           buffer.data(), buffer.size());
+        if (ZSTD_isError(size)) {
+            throw_pack_error(translate("could not compress %s"), catalog);
+        }
+        frames.append(compressed, 0, size);
+        put_u32(table, static_cast<uint32_t>(size));
+        put_u32(table, static_cast<uint32_t>(buffer.size()));
+        put_u32(table, section);
+        buffer.clear();
+    };
+
+    for (const auto& record : records) {
+        const PackSection current = is_file_list(key_name(record.key), names)
+                                        ? PACK_FILES
+                                        : PACK_COMMANDS;
+        if (current != section) {
+            compress();
+            section = current;
+        }
+        put_u32(buffer, static_cast<uint32_t>(record.key.size()));
+        put_u32(buffer, static_cast<uint32_t>(record.value.size()));
+        buffer += record.key;
+        buffer += record.value;
+        stats.bytes += record.key.size() + record.value.size();
+        ++stats.records;
+        if (buffer.size() >= PACK_FRAME_SIZE) {
+            compress();
+        }
+    }
+    compress();
+
+    string header;
+    put_u32(header, SKIPPABLE_MAGIC);
+    put_u32(header, static_cast<uint32_t>(HEADER_FIELDS_SIZE + table.size() +
+                                          dictionary.size()));
+    header.append(PACK_MAGIC, sizeof(PACK_MAGIC));
+    put_u32(header, PACK_VERSION);
+    put_u32(header, static_cast<uint32_t>(table.size() / FRAME_ENTRY_SIZE));
+    put_u32(header, static_cast<uint32_t>(dictionary.size()));
+    header += table;
+    header += dictionary;
+
+    // readers of the published pack see either the old or the new one
+    const bf::path temp = pack.string() + ".part";
+    ofstream out(temp.c_str(), ios::binary | ios::trunc);
+    out << header << frames;
+    out.close();
+    boost::system::error_code ec;
+    if (!out) {
+        bf::remove(temp, ec);
+        throw_pack_error(translate("could not write %s"), temp);
+    }
+    bf::rename(temp, pack, ec);
+    if (ec) {
+        bf::remove(temp, ec);
+        throw_pack_error(translate("could not write %s"), pack);
+    }
+
+    stats.compressed = header.size() + frames.size();
+    return stats;
+}
+
+PackInstaller::PackInstaller(const PackHeader& header,
+                             const unsigned sections,
+                             const uint64_t begin,
+                             bf::path temp)
+    : m_header(header)
+    , m_sections(sections)
+    , m_temp(move(temp))
+    , m_offset(begin)
+    , m_next(0)
+    , m_context(ZSTD_createDCtx())
+    , m_dictionary(nullptr)
+    , m_tdb(nullptr)
+    , m_failed(false) {
+    skipFrames();
+    if (!m_header.dictionary().empty()) {
+        m_dictionary = ZSTD_createDDict(m_header.dictionary().data(),
+                                        m_header.dictionary().size());
+    }
+
+    m_tdb = tdb_open(m_temp.c_str(), 512, 0, O_RDWR | O_CREAT | O_TRUNC,
+                     S_IRWXU | S_IRGRP | S_IROTH);
+    if (m_tdb == nullptr) {
+        ZSTD_freeDDict(m_dictionary);
+        ZSTD_freeDCtx(m_context);
+        throw_pack_error(translate("Error opening tdb database: %s"), m_temp,
+                         CONNECT_ERROR);
+    }
+    if (tdb_transaction_start(m_tdb) != 0) {
+        tdb_close(m_tdb);
+        boost::system::error_code ec;
+        bf::remove(m_temp, ec);
+        ZSTD_freeDDict(m_dictionary);
+        ZSTD_freeDCtx(m_context);
+        throw_pack_error(translate("could not write %s"), m_temp);
+    }
+}
+
+PackInstaller::~PackInstaller() {
+    if (m_tdb != nullptr) {
+        tdb_transaction_cancel(m_tdb);
+        tdb_close(m_tdb);
+        boost::system::error_code ec;
+        bf::remove(m_temp, ec);
+    }
+    ZSTD_freeDDict(m_dictionary);
+    ZSTD_freeDCtx(m_context);
+}
+
+bool PackInstaller::write(const char* data, size_t size) {
+    const auto& frames = m_header.frames();
+    while (!m_failed && size > 0 && m_next < frames.size()) {
+        const PackFrame& current = frames[m_next];
+        // the header or frames of other sections
+        if (m_offset < current.offset) {
+            const size_t skip = static_cast<size_t>(
+                min<uint64_t>(size, current.offset - m_offset));
+            data += skip;
+            size -= skip;
+            m_offset += skip;
+            continue;
+        }
+        // the data started in the middle of the frame
+        if (m_offset != current.offset + m_buffer.size()) {
+            m_failed = true;
+            break;
+        }
+
+        const uint64_t end = current.offset + current.compressed;
+        const size_t take =
+            static_cast<size_t>(min<uint64_t>(size, end - m_offset));
+        m_buffer.append(data, take);
+        data += take;
+        size -= take;
+        m_offset += take;
+        if (m_buffer.size() < current.compressed) {
+            continue;
+        }
+
+        m_failed = !frame();
+        m_buffer.clear();
+        ++m_next;
+        skipFrames();
+    }
+    // whatever follows the last wanted frame is of no interest
+    m_offset += size;
+    return !m_failed;
+}
+
+void PackInstaller::skipFrames() {
+    const auto& frames = m_header.frames();
+    while (m_next < frames.size() &&
+           (frames[m_next].section & m_sections) == 0) {
+        ++m_next;
+    }
+}
+
+bool PackInstaller::frame() {
+    const PackFrame& current = m_header.frames()[m_next];
+    if (current.size > PACK_FRAME_SIZE + PACK_RECORD_SIZE) {
+        return false;
+    }
+    m_records.resize(current.size);
+    const size_t size =
+        m_dictionary != nullptr
+            ? ZSTD_decompress_usingDDict(m_context, &m_records[0],
+                                         m_records.size(), m_buffer.data(),
+                                         m_buffer.size(), m_dictionary)
+            : ZSTD_decompressDCtx(m_context, &m_records[0], m_records.size(),
+                                  m_buffer.data(), m_buffer.size());
+    if (ZSTD_isError(size) || size != current.size) {
+        return false;
+    }
+
+    const char* ptr = m_records.data();
+    const char* const end = ptr + m_records.size();
+    while (ptr < end) {
+        if (end - ptr < 8) {
+            return false;
+        }
+        const uint32_t key_size = get_u32(ptr);
+        const uint32_t value_size = get_u32(ptr + 4);
+        ptr += 8;
+        if (static_cast<uint64_t>(end - ptr) <
+            static_cast<uint64_t>(key_size) + value_size) {
+            return false;
+        }
+        TDB_DATA key;
+        key.dptr = reinterpret_cast<unsigned char*>(const_cast<char*>(ptr));
+        key.dsize = key_size;
+        ptr += key_size;
+        TDB_DATA value;
+        value.dptr = reinterpret_cast<unsigned char*>(const_cast<char*>(ptr));
+        value.dsize = value_size;
+        ptr += value_size;
+        if (tdb_store(m_tdb, key, value, TDB_REPLACE) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PackInstaller::complete() const {
+    return !m_failed && m_next >= m_header.frames().size();
+}
+
+void PackInstaller::commit(const bf::path& target) {
+    if (!complete() || m_tdb == nullptr) {
+        throw_pack_error(translate("incomplete or corrupt catalog pack for %s"),
+                         target);
+    }
+    // a later sync fetches the catalog again if it wants more sections
+    const string sections = to_string(m_sections);
+    const TDB_DATA key = sections_key();
+    TDB_DATA value;
+    value.dptr =
+        reinterpret_cast<unsigned char*>(const_cast<char*>(sections.c_str()));
+    value.dsize = sections.size() + 1;
+    const bool committed = tdb_store(m_tdb, key, value, TDB_REPLACE) == 0 &&
+                           tdb_transaction_commit(m_tdb) == 0;
+    tdb_close(m_tdb);
+    m_tdb = nullptr;
+
+    boost::system::error_code ec;
+    if (committed) {
+        bf::rename(m_temp, target, ec);
+    }
+    if (!committed || ec) {
+        bf::remove(m_temp, ec);
+        throw_pack_error(translate("could not write %s"), target);
+    }
+}
+
+void install_catalog_pack(const bf::path& path,
+                          const unsigned sections,
+                          const bf::path& target) {
+    ifstream in(path.c_str(), ios::binary);
+    PackHeader header;
+    string data(FRAME_HEADER_SIZE, '\0');
+    in.read(&data[0], data.size());
+    size_t size = header.parse(data);
+    if (in && size > data.size()) {
+        const size_t read = data.size();
+        data.resize(size);
+        in.read(&data[read], size - read);
+        size = header.parse(data);
+    }
+    if (!in || size == 0 || size > data.size()) {
+        throw_pack_error(translate("not a catalog pack: %s"), path);
+    }
+
+    const pair<uint64_t, uint64_t> range = header.range(sections);
+    PackInstaller installer(header, sections, range.first,
+                            target.string() + ".part");
+    in.seekg(static_cast<streamoff>(range.first));
+    unique_ptr<char[]> buffer(new char[READ_BLOCK_SIZE]);
+    uint64_t left = range.second - range.first;
+    while (left > 0 && in) {
+        in.read(buffer.get(),
+                static_cast<streamsize>(min<uint64_t>(left, READ_BLOCK_SIZE)));
+        const size_t read = static_cast<size_t>(in.gcount());
+        if (!installer.write(buffer.get(), read)) {
+            break;
+        }
+        left -= read;
+    }
+    installer.commit(target);
+}
+
+unsigned installed_sections(const bf::path& catalog) {
+    TDB_CONTEXT* tdb = tdb_open(catalog.c_str(), 512, 0, O_RDONLY, 0);
+    if (tdb == nullptr) {
+        return 0;
+    }
+    const TDB_DATA value = tdb_fetch(tdb, sections_key());
+    tdb_close(tdb);
+    if (value.dptr == nullptr) {
+        return PACK_ALL;
+    }
+    const string sections(reinterpret_cast<const char*>(value.dptr),
+                          strnlen(reinterpret_cast<const char*>(value.dptr),
+                                  value.dsize));
+    free(value.dptr);
+    return static_cast<unsigned>(strtoul(sections.c_str(), nullptr, 10)) &
+           PACK_ALL;
+}
+
+}  // namespace cnf
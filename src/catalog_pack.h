@@ -0,0 +1,156 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CATALOG_PACK_H_
+#define CATALOG_PACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <tdb.h>
+#include <zstd.h>
+
+namespace cnf {
+
+// The transfer format of a catalog, published next to it as
+// <catalog>.tdb.zst:
+//
+//   header  a zstd skippable frame with "CNFP", the format version, the
+//           frame table and a zstd dictionary trained on the records
+//   frames  zstd frames of about PACK_FRAME_SIZE bytes of records each,
+//           those of PACK_COMMANDS first, then those of PACK_FILES
+//
+// A record is the length of its key and value (4 bytes each, little
+// endian) followed by the raw key and value. Every frame is compressed
+// with the dictionary and a checksum on its own, so a client may fetch the
+// header and then only the byte range of the sections it wants. Installing
+// a pack writes a fresh tdb file, without the dead space and padding of the
+// published one.
+
+enum PackSection : uint32_t {
+    // the owners of the commands, the package versions and the indexes:
+    // everything a lookup needs
+    PACK_COMMANDS = 1,
+    // the file lists of the packages, only shown along with the results
+    PACK_FILES = 2,
+    PACK_ALL = PACK_COMMANDS | PACK_FILES
+};
+
+const size_t PACK_FRAME_SIZE = 256 << 10;
+// The largest record a pack holds. A frame ends after the record that
+// fills it, so no frame is larger than PACK_FRAME_SIZE + PACK_RECORD_SIZE.
+const size_t PACK_RECORD_SIZE = 32 << 20;
+
+struct PackFrame {
+    uint64_t offset;      // from the start of the pack
+    uint32_t compressed;  // bytes in the pack
+    uint32_t size;        // bytes of records
+    PackSection section;
+};
+
+class PackHeader {
+public:
+    // Parses the header at the start of data. Returns the size of the
+    // header, 0 if data is not a pack. A result larger than data means the
+    // header is incomplete and has to be parsed again with more data.
+    size_t parse(const std::string& data);
+
+    const std::vector<PackFrame>& frames() const { return m_frames; }
+    const std::string& dictionary() const { return m_dictionary; }
+
+    // The bytes [first, second) of the pack holding the frames of the
+    // sections, empty if there are none.
+    std::pair<uint64_t, uint64_t> range(unsigned sections) const;
+
+private:
+    std::vector<PackFrame> m_frames;
+    std::string m_dictionary;
+};
+
+struct PackStats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;       // of the records
+    uint64_t compressed = 0;  // size of the pack
+};
+
+// Write the pack of the tdb file catalog to pack, through a temporary file
+// that replaces it. Throws DatabaseException.
+PackStats write_catalog_pack(const boost::filesystem::path& catalog,
+                             const boost::filesystem::path& pack);
+
+// Decompresses the frames of the wanted sections of a pack as their bytes
+// arrive and stores the records in a new tdb file at temp, which replaces
+// the catalog on commit(). Memory is bounded by the size of one frame.
+class PackInstaller {
+public:
+    // The first bytes passed to write() are those at offset begin of the
+    // pack, header has to outlive the installer. Throws DatabaseException
+    // if temp can not be created.
+    PackInstaller(const PackHeader& header,
+                  unsigned sections,
+                  uint64_t begin,
+                  boost::filesystem::path temp);
+    ~PackInstaller();
+    PackInstaller(const PackInstaller&) = delete;
+    PackInstaller& operator=(const PackInstaller&) = delete;
+
+    // Returns false if the data is corrupt; the installer is unusable then.
+    bool write(const char* data, size_t size);
+
+    // whether all frames of the wanted sections were installed
+    bool complete() const;
+
+    // Replace target with the installed catalog. Throws DatabaseException.
+    void commit(const boost::filesystem::path& target);
+
+private:
+    // decompress and store the frame in m_buffer
+    bool frame();
+    // move m_next past the frames of other sections
+    void skipFrames();
+
+    const PackHeader& m_header;
+    const unsigned m_sections;
+    const boost::filesystem::path m_temp;
+    uint64_t m_offset;  // of the next byte passed to write()
+    size_t m_next;      // the frame m_buffer belongs to
+    std::string m_buffer;
+    std::string m_records;
+    ZSTD_DCtx* m_context;
+    ZSTD_DDict* m_dictionary;
+    TDB_CONTEXT* m_tdb;
+    bool m_failed;
+};
+
+// Install the sections of the pack file at path as target.
+void install_catalog_pack(const boost::filesystem::path& path,
+                          unsigned sections,
+                          const boost::filesystem::path& target);
+
+// The sections installed in the catalog: PACK_ALL for one that was not
+// installed from a pack, 0 if it can not be read.
+unsigned installed_sections(const boost::filesystem::path& catalog);
+
+}  // namespace cnf
+
+#endif /* CATALOG_PACK_H_ */
@@ -0,0 +1,183 @@
+#include "catalog_pack.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "db.h"
+#include "db_tdb.h"
+#include "manifest.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+// "<package>-files" records hold file lists, a command of that name would
+// share the record, but other commands may end in "-files"
+void catalog(const bf::path& dir) {
+    cnf::TdbDatabase db("core-x86_64", false, dir.string());
+    for (int i = 0; i < 2000; ++i) {
+        const std::string n = std::to_string(i);
+        db.storePackage(cnf::Package("pkg" + n, "1." + n, "1", "x86_64", "xz",
+                                     {"cmd" + n, "tool" + n, "shared"}));
+    }
+    db.storePackage(cnf::Package("git", "2.0", "1", "x86_64", "xz",
+                                 {"git", "list-files"}));
+    db.flush();
+}
+
+std::string read(const bf::path& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+std::vector<cnf::Package> lookup(const bf::path& dir,
+                                 const std::string& command) {
+    cnf::TdbDatabase db("core-x86_64", true, dir.string());
+    std::vector<cnf::Package> result;
+    db.getPackages(command, result);
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("catalog_pack::round_trip") {
+    TempDir dir;
+    const bf::path source = dir.path / "source";
+    const bf::path client = dir.path / "client";
+    bf::create_directories(source);
+    bf::create_directories(client);
+    catalog(source);
+
+    const bf::path pack = dir.path / "core-x86_64.tdb.zst";
+    const cnf::PackStats stats =
+        cnf::write_catalog_pack(source / "core-x86_64.tdb", pack);
+    CHECK(stats.records > 0);
+    CHECK(stats.compressed < stats.bytes / 2);
+
+    cnf::PackHeader header;
+    const std::string data = read(pack);
+    REQUIRE(header.parse(data) > 0);
+    CHECK(!header.frames().empty());
+
+    cnf::install_catalog_pack(pack, cnf::PACK_ALL,
+                              client / "core-x86_64.tdb");
+    const auto found = lookup(client, "shared");
+    CHECK(found.size() == 2000);
+    const auto git = lookup(client, "list-files");
+    REQUIRE(git.size() == 1);
+    CHECK(git[0].version() == "2.0");
+    CHECK(git[0].files() == std::vector<std::string>({"git", "list-files"}));
+    CHECK(cnf::installed_sections(client / "core-x86_64.tdb") ==
+          cnf::PACK_ALL);
+}
+
+TEST_CASE("catalog_pack::commands_only") {
+    TempDir dir;
+    catalog(dir.path);
+    const bf::path pack = dir.path / "core-x86_64.tdb.zst";
+    cnf::write_catalog_pack(dir.path / "core-x86_64.tdb", pack);
+    const std::string data = read(pack);
+
+    cnf::PackHeader header;
+    const size_t size = header.parse(data.substr(0, 8));
+    REQUIRE(size > 8);
+    REQUIRE(header.parse(data.substr(0, size)) == size);
+
+    // only the bytes of the wanted frames, in small pieces as from the
+    // network
+    const auto range = header.range(cnf::PACK_COMMANDS);
+    CHECK(range.first == size);
+    CHECK(range.second < data.size());
+    const bf::path client = dir.path / "client";
+    bf::create_directories(client);
+    {
+        cnf::PackInstaller installer(header, cnf::PACK_COMMANDS, range.first,
+                                     client / "core-x86_64.tdb.part");
+        for (uint64_t offset = range.first; offset < range.second;
+             offset += 1000) {
+            const size_t length = static_cast<size_t>(
+                std::min<uint64_t>(1000, range.second - offset));
+            REQUIRE(installer.write(data.data() + offset, length));
+        }
+        REQUIRE(installer.complete());
+        installer.commit(client / "core-x86_64.tdb");
+    }
+
+    // the owners are there, the file lists are not
+    const auto found = lookup(client, "list-files");
+    REQUIRE(found.size() == 1);
+    CHECK(found[0].name() == "git");
+    CHECK(found[0].files().empty());
+
+    // a sync wanting the file lists fetches the catalog again
+    CHECK(cnf::installed_sections(client / "core-x86_64.tdb") ==
+          cnf::PACK_COMMANDS);
+    CHECK(cnf::installed_sections(dir.path / "core-x86_64.tdb") ==
+          cnf::PACK_ALL);
+    CHECK(cnf::installed_sections(dir.path / "missing.tdb") == 0);
+}
+
+TEST_CASE("catalog_pack::corrupt") {
+    TempDir dir;
+    catalog(dir.path);
+    const bf::path pack = dir.path / "core-x86_64.tdb.zst";
+    cnf::write_catalog_pack(dir.path / "core-x86_64.tdb", pack);
+    std::string data = read(pack);
+
+    cnf::PackHeader header;
+    const size_t size = header.parse(data);
+    REQUIRE(size > 0);
+    CHECK(cnf::PackHeader().parse("not a pack") == 0);
+
+    data[size + 20] ^= 0x55;
+    cnf::PackInstaller installer(header, cnf::PACK_ALL, 0,
+                                 dir.path / "client.tdb.part");
+    CHECK(!installer.write(data.data(), data.size()));
+    CHECK(!installer.complete());
+    CHECK_THROWS_AS(installer.commit(dir.path / "client.tdb"),
+                    cnf::DatabaseException);
+    CHECK(!bf::exists(dir.path / "client.tdb"));
+
+    // the size of the first frame as sent by a hostile server
+    std::string large = data.substr(0, size);
+    large[8 + 16 + 4] = large[8 + 16 + 5] = large[8 + 16 + 6] =
+        large[8 + 16 + 7] = '\xff';
+    CHECK(cnf::PackHeader().parse(large) == 0);
+}
+
+TEST_CASE("catalog_pack::populate_and_gc") {
+    TempDir dir;
+    const bf::path packages = dir.path / "packages";
+    const bf::path db = dir.path / "db";
+    bf::create_directories(packages);
+    for (const std::string name : {"a", "b"}) {
+        cnf::test::write_package(packages / (name + "-1.0-1-x86_64.pkg.tar.gz"),
+                                 {"usr/bin/" + name});
+    }
+
+    cnf::PopulateOptions options;
+    options.compress = true;
+    cnf::populate(packages, db.string(), "core-x86_64", true, 0, options);
+    // the pack is written before the manifest
+    CHECK(cnf::Manifest().read(db.string()));
+
+    // the pack of the compacted catalog lacks the removed package
+    bf::remove(packages / "b-1.0-1-x86_64.pkg.tar.gz");
+    cnf::collect_garbage({packages}, db.string(), "core-x86_64", 0, options);
+    CHECK(cnf::Manifest().read(db.string()));
+    const bf::path client = dir.path / "client";
+    bf::create_directories(client);
+    cnf::install_catalog_pack(db / "core-x86_64.tdb.zst", cnf::PACK_ALL,
+                              client / "core-x86_64.tdb");
+    CHECK(lookup(client, "a").size() == 1);
+    CHECK(lookup(client, "b").empty());
+}
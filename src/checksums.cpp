@@ -0,0 +1,101 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "checksums.h"
+#include "custom_exceptions.h"
+#include "db.h"
+#include "hash.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+string checksums_path(const string& catalogs_list) {
+    return catalogs_list + ".sums";
+}
+
+void write_checksums(const string& path,
+                     const string& database_path,
+                     const vector<string>& files) {
+    // readers must never see a partial list
+    const string temp = path + ".tmp";
+    ofstream out(temp.c_str(), ios::trunc | ios::out);
+    for (const auto& file : files) {
+        const uint64_t hash =
+            hash_file((bf::path(database_path) / file).string());
+        out << hash_to_string(hash) << "  " << file << "\n";
+    }
+    out.close();
+    if (!out) {
+        throw DatabaseException(
+            IO_ERROR, (format(translate("could not write: %s")) % temp).str());
+    }
+    bf::rename(temp, path);
+}
+
+bool read_checksums(const string& path, vector<Checksum>& result) {
+    ifstream in(path.c_str());
+    if (!in) {
+        return false;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        istringstream entry(line);
+        string hash;
+        Checksum checksum;
+        entry >> hash >> checksum.file;
+        if (!entry || !hash_from_string(hash, checksum.hash) ||
+            checksum.file.find('/') != string::npos) {
+            return false;
+        }
+        result.push_back(checksum);
+    }
+    return true;
+}
+
+VerifyStatus verify_checksum(const string& database_path,
+                             const Checksum& checksum) {
+    const bf::path file = bf::path(database_path) / checksum.file;
+    if (!bf::is_regular_file(file)) {
+        return VERIFY_MISSING;
+    }
+    try {
+        return hash_file(file.string()) == checksum.hash ? VERIFY_OK
+                                                         : VERIFY_MISMATCH;
+    } catch (const InvalidArgumentException&) {
+        return VERIFY_MISSING;
+    }
+}
+
+}  // namespace cnf
@@ -0,0 +1,53 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECKSUMS_H_
+#define CHECKSUMS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnf {
+
+// Content hashes of the catalog files, published next to the catalogs list
+// as "<list>.sums" with one "<xxh64>  <file>" line per catalog (the layout
+// of sha256sum(1)), so broken downloads are caught before installing them.
+struct Checksum {
+    std::string file;
+    uint64_t hash;
+};
+
+enum VerifyStatus { VERIFY_OK, VERIFY_MISMATCH, VERIFY_MISSING };
+
+std::string checksums_path(const std::string& catalogs_list);
+
+// Hash the given files of database_path and write them to path.
+void write_checksums(const std::string& path,
+                     const std::string& database_path,
+                     const std::vector<std::string>& files);
+
+// Returns false if the file is missing or malformed.
+bool read_checksums(const std::string& path, std::vector<Checksum>& result);
+
+VerifyStatus verify_checksum(const std::string& database_path,
+                             const Checksum& checksum);
+
+}  // namespace cnf
+
+#endif /* CHECKSUMS_H_ */
@@ -0,0 +1,47 @@
+# Finds the Zstandard library
+#
+#  Zstd_INCLUDE_DIR - where to find zstd.h and zdict.h
+#  Zstd_LIBRARIES   - List of libraries when using zstd.
+#  Zstd_FOUND       - True if zstd found.
+
+
+if (Zstd_INCLUDE_DIR)
+  # Already in cache, be silent
+  set(Zstd_FIND_QUIETLY TRUE)
+endif (Zstd_INCLUDE_DIR)
+
+find_path(Zstd_INCLUDE_DIR zdict.h
+  /opt/local/include
+  /usr/local/include
+  /usr/include
+)
+
+set(Zstd_NAMES zstd)
+find_library(Zstd_LIBRARY
+  NAMES ${Zstd_NAMES}
+  PATHS /usr/lib /usr/local/lib /opt/local/lib
+)
+
+if (Zstd_INCLUDE_DIR AND Zstd_LIBRARY)
+   set(Zstd_FOUND TRUE)
+   set( Zstd_LIBRARIES ${Zstd_LIBRARY} )
+else (Zstd_INCLUDE_DIR AND Zstd_LIBRARY)
+   set(Zstd_FOUND FALSE)
+   set(Zstd_LIBRARIES)
+endif (Zstd_INCLUDE_DIR AND Zstd_LIBRARY)
+
+if (Zstd_FOUND)
+   if (NOT Zstd_FIND_QUIETLY)
+      message(STATUS "Found zstd Library: ${Zstd_LIBRARY}")
+   endif (NOT Zstd_FIND_QUIETLY)
+else (Zstd_FOUND)
+   if (Zstd_FIND_REQUIRED)
+      message(STATUS "Looked for zstd libraries named ${Zstd_NAMES}.")
+      message(FATAL_ERROR "Could NOT find zstd library")
+   endif (Zstd_FIND_REQUIRED)
+endif (Zstd_FOUND)
+
+mark_as_advanced(
+  Zstd_LIBRARY
+  Zstd_INCLUDE_DIR
+)
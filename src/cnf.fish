@@ -1,6 +1,11 @@
 function __fish_command_not_found_handler --on-event fish_command_not_found
 	if test -x "/usr/bin/cnf-lookup"
-		cnf-lookup -c -- $argv[1]
+		# upper bound for the lookup in milliseconds, see cnf.sh
+		set -l timeout 500
+		if set -q CNF_TIMEOUT_MS
+			set timeout $CNF_TIMEOUT_MS
+		end
+		cnf-lookup -c --timeout-ms $timeout -- $argv[1]
 		if test $status -ne 0
 			__fish_default_command_not_found_handler $argv[1]
 		end
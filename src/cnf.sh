@@ -1,8 +1,11 @@
+# Upper bound for the lookup in milliseconds, so a cold cache or a stalled
+# file system does not block the prompt. Set CNF_TIMEOUT_MS to override.
+
 # zsh
 if [ -n "${ZSH_NAME}" ]; then
     command_not_found_handler () {
         if [ -x /usr/bin/cnf-lookup ]; then
-            cnf-lookup -c -- $1
+            cnf-lookup -c --timeout-ms "${CNF_TIMEOUT_MS:-500}" -- $1
             if [ ! $? -eq 0 ]; then
                 echo "zsh: $1: command not found"
             fi
@@ -17,7 +20,7 @@ fi
 if [ -n "${BASH}" ]; then
     command_not_found_handle () {
         if [ -x /usr/bin/cnf-lookup ]; then
-            cnf-lookup -c -- $1
+            cnf-lookup -c --timeout-ms "${CNF_TIMEOUT_MS:-500}" -- $1
             if [ ! $? -eq 0 ]; then
                 echo "bash: $1: command not found"
             fi
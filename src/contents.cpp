@@ -0,0 +1,97 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <string>
+
+#include "contents.h"
+
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+const char* const BLANKS = " \t";
+
+// the next blank separated token of line starting at pos
+bool next_token(const string& line, size_t& pos, string& token) {
+    const size_t begin = line.find_first_not_of(BLANKS, pos);
+    if (begin == string::npos) {
+        return false;
+    }
+    const size_t end = line.find_first_of(BLANKS, begin);
+    token.assign(line, begin, end == string::npos ? string::npos : end - begin);
+    pos = end == string::npos ? line.size() : end;
+    return true;
+}
+
+}  // namespace
+
+bool parse_contents_line(const string& line, ContentsEntry& entry) {
+    // paths may contain blanks, only the tab ends them
+    const size_t tab = line.find('\t');
+    if (tab == 0 || tab == string::npos) {
+        return false;
+    }
+    entry.path.assign(line, 0, tab);
+
+    size_t pos = tab + 1;
+    string version_release;
+    if (!next_token(line, pos, entry.name) ||
+        !next_token(line, pos, version_release) ||
+        !next_token(line, pos, entry.architecture)) {
+        return false;
+    }
+    string rest;
+    if (next_token(line, pos, rest)) {
+        return false;
+    }
+
+    // versions may contain dashes, releases do not
+    const size_t dash = version_release.rfind('-');
+    if (dash == 0 || dash == string::npos ||
+        dash + 1 == version_release.size()) {
+        return false;
+    }
+    entry.version.assign(version_release, 0, dash);
+    entry.release.assign(version_release, dash + 1, string::npos);
+    return true;
+}
+
+ContentsReader::ContentsReader(istream& in)
+    : m_in(in), m_line(0), m_skipped(0) {}
+
+bool ContentsReader::next(ContentsEntry& entry) {
+    while (getline(m_in, m_buffer)) {
+        ++m_line;
+        if (!m_buffer.empty() && m_buffer.back() == '\r') {
+            m_buffer.pop_back();
+        }
+        if (m_buffer.empty() || m_buffer[0] == '#') {
+            continue;
+        }
+        if (parse_contents_line(m_buffer, entry)) {
+            return true;
+        }
+        ++m_skipped;
+    }
+    return false;
+}
+
+}  // namespace cnf
@@ -0,0 +1,69 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CONTENTS_H_
+#define CONTENTS_H_
+
+#include <cstddef>
+#include <istream>
+#include <string>
+
+namespace cnf {
+
+// One line of a contents index: a path and the package providing it.
+struct ContentsEntry {
+    std::string path;
+    std::string name;
+    std::string version;
+    std::string release;
+    std::string architecture;
+};
+
+// Reads a plain text contents index line by line, without holding more than
+// the current line. Lines look like
+//
+//   usr/bin/ls<TAB>coreutils 9.4-3 x86_64
+//
+// i.e. the path, a tab and the package name, version-release and
+// architecture separated by blanks. Empty lines and lines starting with '#'
+// are ignored, malformed lines are skipped and counted.
+class ContentsReader {
+public:
+    explicit ContentsReader(std::istream& in);
+
+    // Returns false at the end of the input.
+    bool next(ContentsEntry& entry);
+
+    // number of the line read last
+    size_t line() const { return m_line; }
+    size_t skipped() const { return m_skipped; }
+
+private:
+    std::istream& m_in;
+    std::string m_buffer;
+    size_t m_line;
+    size_t m_skipped;
+};
+
+// Parse a single line, returns false if it is malformed.
+bool parse_contents_line(const std::string& line, ContentsEntry& entry);
+
+}  // namespace cnf
+
+#endif /* CONTENTS_H_ */
@@ -0,0 +1,123 @@
+#include "contents.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "db.h"
+#include "db_tdb.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+// sorted by path like a Debian Contents file, the packages interleave
+const char* const CONTENTS =
+    "# generated\n"
+    "usr/bin/ls\tcoreutils 9.4-3 x86_64\n"
+    "usr/bin/vim\tvim 9.1.0-1 x86_64\n"
+    "usr/bin/vimdiff\tvim 9.1.0-1 x86_64\n"
+    "usr/share/doc/coreutils/README\tcoreutils 9.4-3 x86_64\n"
+    "usr/share/man/man1/my file.1\tman-pages 6.9-1 any\n"
+    "/usr/sbin/chroot\tcoreutils 9.4-3 x86_64\n"
+    "this line is broken\n"
+    "\n";
+
+}  // namespace
+
+TEST_CASE("contents::parse_line") {
+    cnf::ContentsEntry entry;
+    REQUIRE(cnf::parse_contents_line(
+        "usr/share/a b/c\tgit-lfs 3.4.0-rc1-2 x86_64", entry));
+    CHECK(entry.path == "usr/share/a b/c");
+    CHECK(entry.name == "git-lfs");
+    CHECK(entry.version == "3.4.0-rc1");
+    CHECK(entry.release == "2");
+    CHECK(entry.architecture == "x86_64");
+
+    CHECK(!cnf::parse_contents_line("usr/bin/ls coreutils 9.4-3 x86_64",
+                                    entry));
+    CHECK(!cnf::parse_contents_line("usr/bin/ls\tcoreutils 9.4 x86_64",
+                                    entry));
+    CHECK(!cnf::parse_contents_line("usr/bin/ls\tcoreutils 9.4-3", entry));
+    CHECK(!cnf::parse_contents_line("usr/bin/ls\tcoreutils 9.4-3 any more",
+                                    entry));
+    CHECK(!cnf::parse_contents_line("\tcoreutils 9.4-3 any", entry));
+}
+
+TEST_CASE("contents::reader") {
+    std::istringstream in(CONTENTS);
+    cnf::ContentsReader reader(in);
+    cnf::ContentsEntry entry;
+    std::vector<std::string> paths;
+    while (reader.next(entry)) {
+        paths.push_back(entry.path);
+    }
+    CHECK(paths.size() == 6);
+    CHECK(paths[4] == "usr/share/man/man1/my file.1");
+    CHECK(reader.skipped() == 1);
+    CHECK(reader.line() == 9);
+}
+
+TEST_CASE("contents::populate") {
+    TempDir dir;
+    std::istringstream in(CONTENTS);
+    cnf::populate_contents(in, dir.path.string(), "core-x86_64", false, 0);
+
+    cnf::TdbDatabase catalog("core-x86_64", true, dir.path.string());
+    std::vector<cnf::Package> result;
+    catalog.getPackages("chroot", result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0].name() == "coreutils");
+    CHECK(result[0].version() == "9.4");
+    CHECK(result[0].release() == "3");
+    CHECK(result[0].files() == std::vector<std::string>({"chroot", "ls"}));
+
+    result.clear();
+    catalog.getPackages("vimdiff", result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0].name() == "vim");
+
+    // packages without commands are indexed as well
+    result.clear();
+    catalog.getPackage("man-pages", result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0].files().empty());
+}
+
+TEST_CASE("contents::newest_version") {
+    CHECK(cnf::compare_versions("9.10.0-1", "9.9.0-1") > 0);
+    CHECK(cnf::compare_versions("1.0rc1-1", "1.0-1") < 0);
+    CHECK(cnf::compare_versions("1:1.0-1", "2.0-1") > 0);
+    CHECK(cnf::compare_versions("1.0-2", "1.0-10") < 0);
+    CHECK(cnf::compare_versions("1.0.a-1", "1.0-1") > 0);
+    CHECK(cnf::compare_versions("1.01-1", "1.1-1") == 0);
+
+    // the lexicographically smaller versions are the older ones
+    TempDir dir;
+    std::istringstream in(
+        "usr/bin/vim\tvim 9.10.0-1 x86_64\n"
+        "usr/bin/vim\tvim 9.9.0-3 x86_64\n"
+        "usr/bin/ex\tvim 9.10.0-1 x86_64\n"
+        "usr/bin/vimtutor\tvim 9.9.0-3 x86_64\n"
+        "usr/bin/vim\tvim 9.10.0-10 x86_64\n"
+        "usr/bin/ex\tvim 9.10.0-10 x86_64\n");
+    cnf::populate_contents(in, dir.path.string(), "core-x86_64", false, 0);
+
+    cnf::TdbDatabase catalog("core-x86_64", true, dir.path.string());
+    std::vector<cnf::Package> result;
+    catalog.getPackages("vim", result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0].version() == "9.10.0");
+    CHECK(result[0].release() == "10");
+    CHECK(result[0].files() == std::vector<std::string>({"ex", "vim"}));
+    result.clear();
+    catalog.getPackages("vimtutor", result);
+    CHECK(result.empty());
+}
@@ -34,7 +34,7 @@ public:
 
 private:
     const int m_code;
-    const std::string& m_message;
+    const std::string m_message;
 };
 
 class InvalidArgumentException : public ErrorCodeException {
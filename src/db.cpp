@@ -20,6 +20,7 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
@@ -28,10 +29,25 @@
 #include <boost/format.hpp>
 #include <boost/locale.hpp>
 
+#include "checksums.h"
 #include "config.h"
+#include "contents.h"
 #include "custom_exceptions.h"
 #include "db_tdb.h"
+#include "executor.h"
+#include "external_sort.h"
+#include "file_list_cache.h"
+#include "fuzzy_scan.h"
+#include "hash.h"
+#include "manifest.h"
+#include "prefetch.h"
+#include "result_cache.h"
 #include "similar.h"
+#include "trace.h"
+
+#ifdef WITH_ZSTD
+#include "catalog_pack.h"
+#endif
 
 namespace bf = boost::filesystem;
 using namespace std;
@@ -40,6 +56,132 @@ using boost::locale::translate;
 
 namespace cnf {
 
+namespace {
+
+const string ARCHITECTURES[] = {"i686", "x86_64"};
+
+// memory for grouping a contents index by package without --memory-limit
+const size_t CONTENTS_MEMORY_LIMIT = 64 << 20;
+
+// The catalogs of a mirror for one architecture with their package
+// directories, the architecture specific one first.
+vector<pair<string, vector<bf::path>>> mirror_catalogs(
+    const bf::path& mirror_path,
+    const string& architecture) {
+    using dirIter = bf::directory_iterator;
+
+    vector<pair<string, vector<bf::path>>> result;
+    for (dirIter iter = dirIter(mirror_path); iter != dirIter(); ++iter) {
+        vector<bf::path> dirs;
+        for (const auto& sub : {architecture, string("any")}) {
+            const bf::path dir = bf::path(*iter) / "os" / sub;
+            if (bf::is_directory(dir)) {
+                dirs.push_back(dir);
+            }
+        }
+        if (!dirs.empty()) {
+            result.emplace_back(
+                bf::path(*iter).stem().string() + "-" + architecture, dirs);
+        }
+    }
+    return result;
+}
+
+// The commands of all catalogs near search_string, nearest first. Returns
+// false if a catalog has no command index.
+bool scan_commands(const string& search_string,
+                   const string& database_path,
+                   const vector<string>& catalogs,
+                   const LookupOptions& options,
+                   vector<string>& terms) {
+    vector<string> names;
+    for (const auto& catalog : catalogs) {
+        try {
+            // closed again before probe_catalogs() opens the catalog
+            if (!getDatabase(catalog, true, database_path)
+                     ->getCommands(names)) {
+                return false;
+            }
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    const CommandDictionary dictionary(move(names));
+    for (auto& match :
+         dictionary.search(search_string, options.max_distance,
+                           options.max_matches, options.deadline)) {
+        terms.push_back(move(match.name));
+    }
+    return true;
+}
+
+// The commands of all catalogs containing part, shortest first and by name
+// among equally long ones, at most options.max_matches of them.
+void contained_commands(const string& part,
+                        const string& database_path,
+                        const vector<string>& catalogs,
+                        const LookupOptions& options,
+                        vector<string>& terms) {
+    vector<string> names;
+    for (const auto& catalog : catalogs) {
+        if (options.deadline.expired()) {
+            break;
+        }
+        try {
+            const shared_ptr<Database> db =
+                getDatabase(catalog, true, database_path);
+            vector<string> commands;
+            // catalogs written before the trigram index are scanned, those
+            // without a command index record by record
+            if (db->findCommands(part, names)) {
+                continue;
+            }
+            if (!db->getCommands(commands)) {
+                db->scanCommands(commands);
+            }
+            for (auto& command : commands) {
+                if (command.find(part) != string::npos) {
+                    names.push_back(move(command));
+                }
+            }
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    sort(names.begin(), names.end(), [](const string& lhs, const string& rhs) {
+        return lhs.size() < rhs.size() ||
+               (lhs.size() == rhs.size() && lhs < rhs);
+    });
+    names.erase(unique(names.begin(), names.end()), names.end());
+    if (names.size() > options.max_matches) {
+        names.resize(options.max_matches);
+    }
+    terms.insert(terms.end(), make_move_iterator(names.begin()),
+                 make_move_iterator(names.end()));
+}
+
+// The union of the word models of all catalogs. Returns false if a catalog
+// has none, candidates would be missed with the others only.
+bool word_model(const string& database_path,
+                const vector<string>& catalogs,
+                WordModel& model) {
+    for (const auto& catalog : catalogs) {
+        try {
+            if (!getDatabase(catalog, true, database_path)
+                     ->getWordModel(model)) {
+                return false;
+            }
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 const shared_ptr<Database> getDatabase(const string& id,
                                        const bool readonly,
                                        const string& base_path) {
@@ -50,89 +192,245 @@ void getCatalogs(const string& database_path, vector<string>& result) {
     TdbDatabase::getCatalogs(database_path, result);
 }
 
-void lookup(const string& search_string,
+void ResultMap::insert(const string& repository, vector<Package>&& packages) {
+    auto group = lower_bound(
+        m_groups.begin(), m_groups.end(), repository,
+        [](const value_type& g, const string& r) { return g.first < r; });
+    if (group == m_groups.end() || group->first != repository) {
+        group = m_groups.emplace(group, repository, vector<Package>());
+    }
+
+    vector<Package>& target = group->second;
+    const size_t old_size = target.size();
+    target.insert(target.end(), make_move_iterator(packages.begin()),
+                  make_move_iterator(packages.end()));
+    packages.clear();
+
+    // stable, so that unique() keeps the package that was there first
+    stable_sort(target.begin() + old_size, target.end());
+    inplace_merge(target.begin(), target.begin() + old_size, target.end());
+    // by name only, like the std::set<Package> this replaces: a package
+    // built for several architectures is shown once per repository
+    target.erase(unique(target.begin(), target.end(),
+                        [](const Package& lhs, const Package& rhs) {
+                            return lhs.name() == rhs.name();
+                        }),
+                 target.end());
+}
+
+bool lookup(const string& search_string,
             const string& database_path,
             ResultMap& result,
-            vector<string>* const inexact_matches) {
+            vector<string>* const inexact_matches,
+            const LookupOptions& options) {
     vector<string> catalogs;
-    getCatalogs(database_path, catalogs);
+    Manifest manifest;
+    bool have_manifest = false;
+    {
+        CNF_TRACE_SCOPE(PHASE_CATALOGS);
+        have_manifest = manifest.read(database_path);
+        if (have_manifest) {
+            for (const auto& catalog : manifest.catalogs()) {
+                catalogs.push_back(catalog.name);
+            }
+        } else {
+            // missing or stale, getCatalogs() would only read it again
+            TdbDatabase::scanCatalogs(database_path, catalogs);
+        }
+    }
+
+    // Only a manifest tells cheaply whether the catalogs changed, so results
+    // are cached only if there is a fresh one.
+    unique_ptr<ResultCache> cache;
+    string cache_ident;
+    uint64_t cache_key = 0;
+    if (options.use_cache && have_manifest) {
+        // the backends differ in which similar commands they find
+        string kind = "exact:";
+        if (inexact_matches && options.contains) {
+            kind = (format("contains-%d:") % options.max_matches).str();
+        } else if (inexact_matches && options.fuzzy == FUZZY_SCAN) {
+            kind = (format("scan-%d-%d:") % options.max_distance %
+                    options.max_matches)
+                       .str();
+        } else if (inexact_matches) {
+            kind = "inexact:";
+        }
+        cache_ident = kind +
+                      database_path + ":" +
+                      hash_to_string(manifest.stamp()) + ":" + search_string;
+        cache_key = hash_bytes(cache_ident.data(), cache_ident.size());
+        cache.reset(new ResultCache(ResultCache::default_path()));
+        if (cache->get(cache_key, cache_ident, result, inexact_matches)) {
+            CNF_TRACE_COUNT(COUNTER_CACHE_HITS, 1);
+            return true;
+        }
+    }
 
-    if (!catalogs.empty()) {
-        vector<string> terms;
+    if (catalogs.empty()) {
+        cout << format(translate("WARNING: No database for lookup!")) << endl;
+        return true;
+    }
+
+    // the catalog list may have come from a slow disk already
+    if (options.deadline.expired()) {
+        return false;
+    }
+
+    vector<string> terms;
+    if (inexact_matches && options.contains) {
+        CNF_TRACE_SCOPE(PHASE_SIMILAR);
+        contained_commands(search_string, database_path, catalogs, options,
+                           terms);
+    } else if (inexact_matches) {
+        CNF_TRACE_SCOPE(PHASE_SIMILAR);
+        if (options.fuzzy != FUZZY_SCAN ||
+            !scan_commands(search_string, database_path, catalogs, options,
+                           terms)) {
+            WordModel model;
+            terms = word_model(database_path, catalogs, model)
+                        ? similar_words(search_string, model)
+                        : similar_words(search_string);
+        }
+    } else {
+        terms.push_back(search_string);
+    }
+
+    // the scan stops early, without probing anything
+    if (options.deadline.expired()) {
+        return false;
+    }
+
+    vector<CatalogHits> hits;
+    const bool complete =
+        probe_catalogs(database_path, catalogs, terms, options.threads,
+                       options.deadline, hits);
+
+    for (size_t i = 0; i < catalogs.size(); ++i) {
+        if (hits[i].packages.empty()) {
+            continue;
+        }
+        const string& catalog = catalogs[i];
+        result.insert(catalog.substr(0, catalog.rfind('-')),
+                      move(hits[i].packages));
         if (inexact_matches) {
-            terms = similar_words(search_string);
+            inexact_matches->insert(inexact_matches->end(),
+                                    hits[i].terms.begin(), hits[i].terms.end());
         }
+    }
 
-        for (const auto& catalog : catalogs) {
-            vector<Package> packs;
+    if (cache && complete) {
+        cache->put(cache_key, cache_ident, result, inexact_matches);
+    }
+    return complete;
+}
 
-            try {
-                if (inexact_matches == nullptr) {
-                    getDatabase(catalog, true, database_path)
-                        ->getPackages(search_string, packs);
-                } else {
-                    const shared_ptr<Database>& d =
-                        getDatabase(catalog, true, database_path);
-
-                    for (const auto& term : terms) {
-                        vector<Package> tempPack;
-                        d->getPackages(term, tempPack);
-                        if (!tempPack.empty()) {
-                            packs.insert(packs.end(), tempPack.begin(),
-                                         tempPack.end());
-                            inexact_matches->push_back(term);
-                        }
-                    }
-                }
+void lookup_packages(const string& pattern,
+                     const string& database_path,
+                     ResultMap& result) {
+    vector<string> catalogs;
+    getCatalogs(database_path, catalogs);
 
-            } catch (const DatabaseException& e) {
-                cerr << e.what() << endl;
-            }
+    for (const auto& catalog : catalogs) {
+        vector<Package> packs;
+
+        try {
+            const shared_ptr<Database>& d =
+                getDatabase(catalog, true, database_path);
 
-            if (!packs.empty()) {
-                result[catalog.substr(0, catalog.rfind('-'))].insert(
-                    packs.begin(), packs.end());
+            vector<string> names;
+            d->findPackages(pattern, names);
+            for (const auto& name : names) {
+                d->getPackage(name, packs);
             }
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+        }
+
+        if (!packs.empty()) {
+            result.insert(catalog.substr(0, catalog.rfind('-')), move(packs));
+        }
+    }
+}
+
+vector<pair<string, vector<bf::path>>> mirror_layout(
+    const bf::path& mirror_path) {
+    vector<pair<string, vector<bf::path>>> result;
+    for (const auto& architecture : ARCHITECTURES) {
+        for (auto& catalog : mirror_catalogs(mirror_path, architecture)) {
+            result.push_back(move(catalog));
+        }
+    }
+    return result;
+}
+
+#ifdef WITH_ZSTD
+void publish_pack(const string& database_path,
+                  const string& catalog,
+                  const uint8_t verbosity) {
+    const bf::path tdb = bf::path(database_path) / (catalog + ".tdb");
+    try {
+        const PackStats stats =
+            write_catalog_pack(tdb, tdb.string() + ".zst");
+        if (verbosity > 0) {
+            cout << format(translate("%s: packed %d records, %d of %d bytes")) %
+                        catalog % stats.records % stats.compressed %
+                        stats.bytes
+                 << endl;
+        }
+    } catch (const DatabaseException& e) {
+        cerr << e.what() << endl;
+    }
+}
+#endif
+
+void update_checksums(const string& database_path) {
+    for (const auto& architecture : ARCHITECTURES) {
+        const bf::path list =
+            bf::path(database_path) / ("catalogs-" + architecture + "-tdb");
+        ifstream in(list.c_str());
+        if (!in) {
+            continue;
+        }
+        vector<string> files;
+        string file;
+        while (in >> file) {
+            files.push_back(file);
+        }
+
+        try {
+            write_checksums(checksums_path(list.string()), database_path,
+                            files);
+        } catch (const ErrorCodeException& e) {
+            cerr << e.what() << endl;
         }
-    } else {
-        cout << format(translate("WARNING: No database for lookup!")) << endl;
     }
 }
 
 void populate_mirror(const bf::path& mirror_path,
                      const string& database_path,
                      const bool truncate,
-                     const uint8_t verbosity) {
-    using dirIter = bf::directory_iterator;
-
-    static const string architectures[] = {"i686", "x86_64"};
-
-    for (const auto& architecture : architectures) {
+                     const uint8_t verbosity,
+                     const PopulateOptions& options) {
+    for (const auto& architecture : ARCHITECTURES) {
         vector<string> catalogs;
 
-        for (dirIter iter = dirIter(mirror_path); iter != dirIter(); ++iter) {
-            const string& catalog =
-                bf::path(*iter).stem().string() + "-" + architecture;
-
+        // a catalog spans several directories, it is packed once at the end
+        PopulateOptions dir_options = options;
+        dir_options.compress = false;
+        for (const auto& catalog : mirror_catalogs(mirror_path, architecture)) {
             bool truncated = !truncate;
-
-            bool list_catalog = false;
-
-            bf::path dir = bf::path(*iter) / "os" / architecture;
-            if (bf::is_directory(dir)) {
-                populate(dir, database_path, catalog, !truncated, verbosity);
+            for (const auto& dir : catalog.second) {
+                populate(dir, database_path, catalog.first, !truncated,
+                         verbosity, dir_options);
                 truncated = true;
-                list_catalog = true;
-            }
-
-            dir = bf::path(*iter) / "os" / "any";
-            if (bf::is_directory(dir)) {
-                populate(dir, database_path, catalog, !truncated, verbosity);
-                list_catalog = true;
             }
-            if (list_catalog) {
-                catalogs.push_back(catalog);
+#ifdef WITH_ZSTD
+            if (options.compress) {
+                publish_pack(database_path, catalog.first, verbosity);
             }
+#endif
+            catalogs.push_back(catalog.first);
         }
 
         const bf::path& catalogs_file_name =
@@ -142,10 +440,34 @@ void populate_mirror(const bf::path& mirror_path,
 
         catalogs_file.open(catalogs_file_name.c_str(), ios::trunc | ios::out);
 
+        vector<string> files;
         for (const auto& catalog : catalogs) {
             catalogs_file << catalog << ".tdb" << endl;
+            files.push_back(catalog + ".tdb");
         }
         catalogs_file.close();
+
+        try {
+            write_checksums(checksums_path(catalogs_file_name.string()),
+                            database_path, files);
+        } catch (const ErrorCodeException& e) {
+            cerr << e.what() << endl;
+        }
+    }
+    // the lists and checksums changed the directory after the catalogs
+    // were hashed
+    Manifest::update(database_path);
+
+    // a mirror run sees all packages, the others are gone
+    if (options.file_lists) {
+        const size_t pruned = options.file_lists->prune();
+        if (verbosity > 0) {
+            cout << format(translate("File list cache: %d hits, %d misses, "
+                                     "%d stale entries removed")) %
+                        options.file_lists->hits() %
+                        options.file_lists->misses() % pruned
+                 << endl;
+        }
     }
 }
 
@@ -153,7 +475,8 @@ void populate(const bf::path& path,
               const string& database_path,
               const string& catalog,
               const bool truncate,
-              const uint8_t verbosity) {
+              const uint8_t verbosity,
+              const PopulateOptions& options) {
     shared_ptr<Database> d;
     try {
         d = getDatabase(catalog, false, database_path);
@@ -168,23 +491,54 @@ void populate(const bf::path& path,
 
     using dirIter = bf::directory_iterator;
 
-    uint32_t count = 0;
-
+    vector<bf::path> files;
     for (dirIter iter = dirIter(path); iter != dirIter(); ++iter) {
-        ++count;
+        files.push_back(*iter);
     }
+    const size_t count = files.size();
 
-    uint32_t current = 0;
+    // only what will actually be decompressed is worth reading ahead
+    Prefetcher prefetcher(
+        files, options.readahead, [&d, &options](const bf::path& file) {
+            try {
+                if (d->hasPackage(Package(file, true))) {
+                    return false;
+                }
+            } catch (const InvalidArgumentException&) {
+                return false;
+            }
+            return !options.file_lists || !options.file_lists->contains(file);
+        });
 
-    for (dirIter iter = dirIter(path); iter != dirIter(); ++iter) {
+    unique_ptr<ExternalSorter> sorter;
+    if (options.memory_limit > 0) {
+        sorter.reset(new ExternalSorter(database_path, options.memory_limit));
+    }
+
+    for (size_t current = 0; current < count; ++current) {
+        const bf::path& file = files[current];
         if (verbosity > 0) {
-            cout << format(translate("[ %d / %d ] %s...")) % ++current % count %
-                        *iter;
+            cout << format(translate("[ %d / %d ] %s...")) % (current + 1) %
+                        count % file;
             cout.flush();
         }
+        if (options.readahead > 0) {
+            prefetcher.advance(current);
+        }
+        // also the entries of packages that are indexed already survive
+        // populate_mirror()'s prune()
+        if (options.file_lists) {
+            options.file_lists->keep(file);
+        }
         try {
-            Package p(*iter, true);
-            d->storePackage(p);
+            Package p(file, true, options.file_lists.get());
+            if (!sorter) {
+                d->storePackage(p);
+            } else if (d->storePackageInfo(p)) {
+                for (const auto& command : p.files()) {
+                    sorter->add(command, p.name());
+                }
+            }
             if (verbosity > 0) {
                 cout << translate("done") << endl;
             }
@@ -198,6 +552,280 @@ void populate(const bf::path& path,
             return;
         }
     }
+
+    if (sorter) {
+        if (verbosity > 0) {
+            cout << format(translate("merging %d sorted runs...")) %
+                        sorter->runs();
+            cout.flush();
+        }
+        try {
+            sorter->merge(
+                [&d](const string& command, const vector<string>& packages) {
+                    d->storeOwners(command, packages);
+                });
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+            return;
+        }
+        if (verbosity > 0) {
+            cout << translate("done") << endl;
+        }
+    }
+
+    // close the catalog before it is packed and hashed for the manifest
+    d->flush();
+    d.reset();
+#ifdef WITH_ZSTD
+    // first, writing the pack changes the directory
+    if (options.compress) {
+        publish_pack(database_path, catalog, verbosity);
+    }
+#endif
+    Manifest::update(database_path, catalog);
+}
+
+void populate_contents(istream& in,
+                       const string& database_path,
+                       const string& catalog,
+                       const bool truncate,
+                       const uint8_t verbosity,
+                       const PopulateOptions& options) {
+    shared_ptr<Database> d;
+    try {
+        d = getDatabase(catalog, false, database_path);
+    } catch (const DatabaseException& e) {
+        cerr << e.what() << endl;
+        return;
+    }
+
+    if (truncate) {
+        d->truncate();
+    }
+
+    const size_t memory_limit = options.memory_limit > 0
+                                    ? options.memory_limit
+                                    : CONTENTS_MEMORY_LIMIT;
+
+    // Contents indexes are usually sorted by path, but a package is stored
+    // with all of its commands at once. Keys are "name version release
+    // architecture", an empty value marks packages without commands.
+    ExternalSorter packages(database_path, memory_limit);
+    ContentsReader reader(in);
+    try {
+        ContentsEntry entry;
+        string key, last_key, command;
+        while (reader.next(entry)) {
+            key = entry.name;
+            key += ' ';
+            key += entry.version;
+            key += ' ';
+            key += entry.release;
+            key += ' ';
+            key += entry.architecture;
+            if (key != last_key) {
+                packages.add(key, "");
+                last_key.swap(key);
+            }
+            // cheap test first, most paths are not in a bin directory
+            if (entry.path.find("bin/") != string::npos &&
+                command_from_path(entry.path, command)) {
+                packages.add(last_key, command);
+            }
+        }
+    } catch (const DatabaseException& e) {
+        cerr << e.what() << endl;
+        return;
+    }
+    if (in.bad()) {
+        cerr << format(translate("error while reading the contents index "
+                                 "(line %d)")) %
+                    reader.line()
+             << endl;
+        return;
+    }
+    if (reader.skipped() > 0) {
+        cerr << format(translate("skipped %d malformed lines of %d")) %
+                    reader.skipped() % reader.line()
+             << endl;
+    }
+
+    unique_ptr<ExternalSorter> owners;
+    if (options.memory_limit > 0) {
+        owners.reset(new ExternalSorter(database_path, options.memory_limit));
+    }
+
+    size_t count = 0;
+    // the versions of a package follow each other, the newest is stored
+    unique_ptr<Package> newest;
+    const auto store = [&]() {
+        if (!newest) {
+            return;
+        }
+        if (!owners) {
+            d->storePackage(*newest);
+        } else if (d->storePackageInfo(*newest)) {
+            for (const auto& command : newest->files()) {
+                owners->add(command, newest->name());
+            }
+        }
+        ++count;
+    };
+    const auto skip = [verbosity](const Package& p) {
+        if (verbosity > 0) {
+            cout << format(translate("skipping %s %s-%s (listed with a newer "
+                                     "version)")) %
+                        p.name() % p.version() % p.release()
+                 << endl;
+        }
+    };
+    try {
+        packages.merge([&](const string& key, const vector<string>& values) {
+            istringstream fields(key);
+            string name, version, release, architecture;
+            fields >> name >> version >> release >> architecture;
+
+            // the values are sorted, the marker comes first
+            vector<string> files(values.begin() + 1, values.end());
+            unique_ptr<Package> p(new Package(name, version, release,
+                                              architecture, "", move(files)));
+            if (newest && newest->name() == name) {
+                if (compare_versions(version + "-" + release,
+                                     newest->version() + "-" +
+                                         newest->release()) <= 0) {
+                    skip(*p);
+                    return;
+                }
+                skip(*newest);
+            } else {
+                store();
+            }
+            newest = move(p);
+        });
+        store();
+
+        if (owners) {
+            owners->merge(
+                [&d](const string& command, const vector<string>& packages) {
+                    d->storeOwners(command, packages);
+                });
+        }
+    } catch (const DatabaseException& e) {
+        cerr << e.what() << endl;
+        return;
+    }
+
+    if (verbosity > 0) {
+        cout << format(translate("%s: indexed %d packages from %d lines")) %
+                    catalog % count % reader.line()
+             << endl;
+    }
+
+    // close the catalog before it is packed and hashed for the manifest
+    d->flush();
+    d.reset();
+#ifdef WITH_ZSTD
+    // first, writing the pack changes the directory
+    if (options.compress) {
+        publish_pack(database_path, catalog, verbosity);
+    }
+#endif
+    Manifest::update(database_path, catalog);
+}
+
+namespace {
+
+// collect_garbage() without refreshing the checksums and the manifest
+uint64_t remove_stale(const vector<bf::path>& paths,
+                      const string& database_path,
+                      const string& catalog,
+                      const uint8_t verbosity,
+                      const PopulateOptions& options) {
+    using dirIter = bf::directory_iterator;
+
+    set<string> live;
+    for (const auto& path : paths) {
+        for (dirIter iter = dirIter(path); iter != dirIter(); ++iter) {
+            try {
+                live.insert(Package(*iter, true).name());
+            } catch (const InvalidArgumentException& e) {
+                if (verbosity > 0) {
+                    cout << format(translate("skipping (%s)")) % e.what()
+                         << endl;
+                }
+            }
+        }
+    }
+
+    // most likely a wrong path, do not wipe the catalog
+    if (live.empty()) {
+        cerr << format(translate("No packages found for %s, skipping garbage "
+                                 "collection")) %
+                    catalog
+             << endl;
+        return 0;
+    }
+
+    const bf::path file = bf::path(database_path) / (catalog + ".tdb");
+    boost::system::error_code ec;
+    const uintmax_t before = bf::file_size(file, ec);
+
+    GarbageStats stats;
+    try {
+        shared_ptr<Database> d = getDatabase(catalog, false, database_path);
+        stats = d->removeStale(live);
+    } catch (const DatabaseException& e) {
+        cerr << e.what() << endl;
+        return 0;
+    }
+#ifdef WITH_ZSTD
+    // clients syncing from the pack would keep the removed packages
+    if (options.compress) {
+        publish_pack(database_path, catalog, verbosity);
+    }
+#else
+    (void)options;
+#endif
+
+    const uintmax_t after = bf::file_size(file, ec);
+    const uint64_t reclaimed = !ec && after < before ? before - after : 0;
+
+    cout << format(translate("%s: removed %d packages and %d stale owner "
+                             "entries, reclaimed %d bytes")) %
+                catalog % stats.packages % stats.owners % reclaimed
+         << endl;
+    return reclaimed;
+}
+
+}  // namespace
+
+uint64_t collect_garbage(const vector<bf::path>& paths,
+                         const string& database_path,
+                         const string& catalog,
+                         const uint8_t verbosity,
+                         const PopulateOptions& options) {
+    const uint64_t reclaimed =
+        remove_stale(paths, database_path, catalog, verbosity, options);
+    // the compacted catalog no longer matches the published checksums
+    update_checksums(database_path);
+    Manifest::update(database_path);
+    return reclaimed;
+}
+
+uint64_t collect_garbage_mirror(const bf::path& mirror_path,
+                                const string& database_path,
+                                const uint8_t verbosity,
+                                const PopulateOptions& options) {
+    uint64_t reclaimed = 0;
+    for (const auto& architecture : ARCHITECTURES) {
+        for (const auto& catalog : mirror_catalogs(mirror_path, architecture)) {
+            reclaimed += remove_stale(catalog.second, database_path,
+                                      catalog.first, verbosity, options);
+        }
+    }
+    update_checksums(database_path);
+    Manifest::update(database_path);
+    return reclaimed;
 }
 
 }  // namespace cnf
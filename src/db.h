@@ -20,18 +20,26 @@
 #define DB_H_
 
 #include <cstdint>
-#include <map>
+#include <istream>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "config.h"
+#include "deadline.h"
 #include "package.h"
+#include "similar.h"
 
 namespace cnf {
 
-enum DatabaseError { CONNECT_ERROR };
+enum DatabaseError { CONNECT_ERROR, IO_ERROR };
+
+struct GarbageStats {
+    size_t packages = 0;  // packages removed
+    size_t owners = 0;    // stale entries removed from owner lists
+};
 
 class Database {
 public:
@@ -42,8 +50,47 @@ public:
         , m_readonly(readonly)
         , m_basePath(std::move(base_path)) {}
     virtual void storePackage(const Package& p) = 0;
+    // storePackage() without adding the package to the owners of its
+    // commands; returns false if the package is indexed already
+    virtual bool storePackageInfo(const Package& p) = 0;
+    // whether this version and release of the package is indexed
+    virtual bool hasPackage(const Package& p) const = 0;
+    // merge packages into the owners of a command
+    virtual void storeOwners(const std::string& command,
+                             const std::vector<std::string>& packages) = 0;
     virtual void getPackages(const std::string& search,
                              std::vector<Package>& result) const = 0;
+    virtual void getPackage(const std::string& name,
+                            std::vector<Package>& result) const = 0;
+    // all command names; returns false if the catalog has no such index
+    virtual bool getCommands(std::vector<std::string>& result) const = 0;
+    // all command names, read from the records of the catalog; slow, for
+    // catalogs without a command index
+    virtual void scanCommands(std::vector<std::string>& result) const = 0;
+    // adds the command names containing part, sorted; returns false if the
+    // catalog has no trigram index (see TrigramIndex)
+    virtual bool findCommands(const std::string& part,
+                              std::vector<std::string>& result) const = 0;
+    // adds the model of the command names; false if the catalog has none
+    virtual bool getWordModel(WordModel& model) const = 0;
+    // names of the indexed packages matching a glob pattern, sorted
+    virtual void findPackages(const std::string& pattern,
+                              std::vector<std::string>& result) const = 0;
+    // names of all indexed packages, read from the records of the catalog;
+    // slow, but complete for catalogs with no or only a partial package
+    // index
+    virtual void scanPackages(std::vector<std::string>& result) const = 0;
+    // write index updates collected by storePackage
+    virtual void flush() = 0;
+    // Remove the packages not in live, the owner entries of commands the
+    // owner does not provide (anymore) and compact the storage.
+    virtual GarbageStats removeStale(const std::set<std::string>& live) = 0;
+    // Remove one package from the index and the owners of its commands.
+    // Returns false if it was not indexed.
+    virtual bool removePackage(const std::string& name) = 0;
+    // Readers see the changes made in between at once, when committed.
+    virtual void beginTransaction() = 0;
+    virtual void commitTransaction() = 0;
     virtual void truncate() = 0;
     virtual ~Database() = default;
     static void getCatalogs(const std::string& database_path,
@@ -59,7 +106,52 @@ protected:
     const std::string m_basePath;
 };
 
-using ResultMap = std::map<std::string, std::set<Package>>;
+// Lookup results grouped by repository. Groups are kept in a flat vector
+// sorted by repository, each holding its packages sorted by name without
+// duplicates, so iterating yields (repository, packages) pairs like a
+// std::map<std::string, std::set<Package>> would.
+class ResultMap {
+public:
+    using value_type = std::pair<std::string, std::vector<Package>>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    // Add packages to a repository; packages already there win over
+    // packages of the same name.
+    void insert(const std::string& repository, std::vector<Package>&& packages);
+
+    const_iterator begin() const { return m_groups.begin(); }
+    const_iterator end() const { return m_groups.end(); }
+    bool empty() const { return m_groups.empty(); }
+    size_t size() const { return m_groups.size(); }
+
+private:
+    std::vector<value_type> m_groups;
+};
+
+// How inexact lookups find the commands similar to the search string.
+enum FuzzyBackend {
+    // probe the catalogs for every similar_words() candidate
+    FUZZY_CANDIDATES,
+    // scan all command names with a CommandDictionary, falls back to the
+    // candidates for catalogs without a command index
+    FUZZY_SCAN
+};
+
+struct LookupOptions {
+    // share results between lookups through ResultCache
+    bool use_cache = true;
+    // threads probing the catalogs, see probe_catalogs()
+    unsigned threads = 1;
+    // stop probing when it expires; the result is partial then
+    Deadline deadline;
+    FuzzyBackend fuzzy = FUZZY_CANDIDATES;
+    // edit distance and number of the commands FUZZY_SCAN looks up
+    unsigned max_distance = 2;
+    size_t max_matches = 20;
+    // inexact lookups find the commands containing the search string
+    // instead of similar ones, the max_matches shortest of them
+    bool contains = false;
+};
 
 const std::shared_ptr<Database> getDatabase(const std::string& id,
                                             bool readonly,
@@ -68,21 +160,85 @@ const std::shared_ptr<Database> getDatabase(const std::string& id,
 void getCatalogs(const std::string& database_path,
                  std::vector<std::string>& result);
 
-void lookup(const std::string& search_string,
+// Returns false if the deadline expired and result is incomplete.
+bool lookup(const std::string& search_string,
             const std::string& database_path,
             ResultMap& result,
-            std::vector<std::string>* inexact_matches = nullptr);
+            std::vector<std::string>* inexact_matches = nullptr,
+            const LookupOptions& options = LookupOptions());
+
+void lookup_packages(const std::string& pattern,
+                     const std::string& database_path,
+                     ResultMap& result);
+
+class FileListCache;
+
+struct PopulateOptions {
+    // If set, the (command, package) pairs are collected with an
+    // ExternalSorter using about this many bytes and written per command at
+    // the end, instead of updating the owners package by package.
+    size_t memory_limit = 0;
+    // If set, package files are only read if their commands are not cached
+    // yet. populate_mirror() drops the entries it did not need.
+    std::shared_ptr<FileListCache> file_lists;
+    // bytes of the next package files to read ahead, see Prefetcher
+    uint64_t readahead = 64 << 20;
+    // publish the catalogs in the transfer format too, see publish_pack()
+    bool compress = false;
+};
+
+// The catalogs of a mirror for all architectures with their package
+// directories.
+std::vector<std::pair<std::string, std::vector<boost::filesystem::path>>>
+mirror_layout(const boost::filesystem::path& mirror_path);
+
+#ifdef WITH_ZSTD
+// Write <catalog>.tdb.zst, the transfer format of a catalog (see
+// catalog_pack.h), next to the catalog.
+void publish_pack(const std::string& database_path,
+                  const std::string& catalog,
+                  uint8_t verbosity);
+#endif
+
+// Rehash the catalogs of the published catalogs lists after they changed.
+void update_checksums(const std::string& database_path);
 
 void populate_mirror(const boost::filesystem::path& path,
                      const std::string& database_path,
                      bool truncate,
-                     uint8_t verbosity);
+                     uint8_t verbosity,
+                     const PopulateOptions& options = PopulateOptions());
 
 void populate(const boost::filesystem::path& path,
               const std::string& database_path,
               const std::string& catalog,
               bool truncate,
-              uint8_t verbosity);
+              uint8_t verbosity,
+              const PopulateOptions& options = PopulateOptions());
+
+// Index the packages listed in a contents index (see ContentsReader) into
+// catalog, without reading any package file. The lines are grouped by
+// package with an ExternalSorter, so in may be sorted by path.
+void populate_contents(std::istream& in,
+                       const std::string& database_path,
+                       const std::string& catalog,
+                       bool truncate,
+                       uint8_t verbosity,
+                       const PopulateOptions& options = PopulateOptions());
+
+// Drop the packages of a catalog that are no longer in any of paths.
+// Returns the number of bytes reclaimed.
+uint64_t collect_garbage(const std::vector<boost::filesystem::path>& paths,
+                         const std::string& database_path,
+                         const std::string& catalog,
+                         uint8_t verbosity,
+                         const PopulateOptions& options = PopulateOptions());
+
+uint64_t collect_garbage_mirror(
+    const boost::filesystem::path& path,
+    const std::string& database_path,
+    uint8_t verbosity,
+    const PopulateOptions& options = PopulateOptions());
 }  // namespace cnf
 
 #endif /* DB_H_ */
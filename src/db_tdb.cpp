@@ -17,17 +17,25 @@
 */
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include <fnmatch.h>
 #include <boost/format.hpp>
 #include <boost/locale.hpp>
 
 #include "config.h"
 #include "db.h"
 #include "db_tdb.h"
+#include "manifest.h"
+#include "trace.h"
+#include "trigram_index.h"
 
 namespace bf = boost::filesystem;
 using namespace std;
@@ -36,11 +44,123 @@ using boost::locale::translate;
 
 namespace cnf {
 
+namespace {
+
+// tdb_fetch() for the lookup path, accounted for by --trace
+TDB_DATA traced_fetch(TDB_CONTEXT* tdb, const TDB_DATA& key) {
+    CNF_TRACE_SCOPE(PHASE_DB_FETCH);
+    const TDB_DATA value = tdb_fetch(tdb, key);
+    CNF_TRACE_COUNT(COUNTER_FETCHES, 1);
+    CNF_TRACE_COUNT(COUNTER_BYTES_READ, value.dsize);
+    return value;
+}
+
+// Reserved keys start with '@', which can not occur in command names.
+const string PACKAGE_INDEX = "@packages";
+
+// All command names of the catalog, sorted, for scanning them in fuzzy
+// lookups.
+const string COMMAND_INDEX = "@commands";
+
+// The WordModel of the commands: "<length>:<count>" pairs and the bigrams
+// as two hex encoded bytes each.
+const string LENGTH_INDEX = "@lengths";
+const string BIGRAM_INDEX = "@bigrams";
+
+// The TrigramIndex of the commands, for finding them by substring.
+const string TRIGRAM_INDEX = "@trigrams";
+
+// The package name index is split into sorted records per first character of
+// the names. PACKAGE_INDEX itself holds the characters in use.
+string package_index_key(const char first) {
+    return PACKAGE_INDEX + ":" + first;
+}
+
+vector<string> split(const string& value) {
+    vector<string> result;
+    istringstream iss(value);
+    copy(istream_iterator<string>(iss), istream_iterator<string>(),
+         back_inserter<vector<string>>(result));
+    return result;
+}
+
+template <typename Container>
+string join(const Container& words) {
+    string result;
+    for (const auto& word : words) {
+        if (!result.empty()) {
+            result += " ";
+        }
+        result += word;
+    }
+    return result;
+}
+
+// the records stored per package, "<name><suffix>"
+const char* const PACKAGE_FIELDS[] = {"-version", "-release", "-architecture",
+                                      "-compression", "-files"};
+
+string key_string(const TDB_DATA& key) {
+    const char* data = reinterpret_cast<const char*>(key.dptr);
+    return string(data, strnlen(data, key.dsize));
+}
+
+int collect_key(TDB_CONTEXT* /*tdb*/,
+                TDB_DATA key,
+                TDB_DATA /*value*/,
+                void* keys) {
+    static_cast<vector<string>*>(keys)->push_back(key_string(key));
+    return 0;
+}
+
+int copy_record(TDB_CONTEXT* /*tdb*/, TDB_DATA key, TDB_DATA value, void* to) {
+    return tdb_store(static_cast<TDB_CONTEXT*>(to), key, value, TDB_INSERT);
+}
+
+struct CommandQuery {
+    const string& part;
+    vector<string>& result;
+};
+
+// tdb_parse_record() parser searching the TrigramIndex in place, without
+// copying the record out of the mapped file
+int find_in_index(TDB_DATA /*key*/, TDB_DATA value, void* query) {
+    const TrigramIndex index(reinterpret_cast<const char*>(value.dptr),
+                             value.dsize);
+    if (!index.valid()) {
+        return -1;
+    }
+    auto* q = static_cast<CommandQuery*>(query);
+    index.find(q->part, q->result);
+    return 0;
+}
+
+bool ends_with(const string& s, const string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// the packages of a catalog, those with a version record among keys
+set<string> indexed_packages(const vector<string>& keys) {
+    set<string> indexed;
+    for (const auto& key : keys) {
+        if (ends_with(key, PACKAGE_FIELDS[0])) {
+            indexed.insert(
+                key.substr(0, key.size() - strlen(PACKAGE_FIELDS[0])));
+        }
+    }
+    return indexed;
+}
+
+}  // namespace
+
 TdbDatabase::TdbDatabase(const string& id,
                          const bool readonly,
                          const string& base_path)
     : Database(id, readonly, base_path)
-    , m_databaseName(m_basePath + "/" + m_id + ".tdb") {
+    , m_databaseName(m_basePath + "/" + m_id + ".tdb")
+    , m_pendingOwnerCount(0)
+    , m_commandIndex(false) {
     if (!bf::is_directory(base_path)) {
         cout << format(translate(
                     "Directory '%s' does not exist. Trying to create it ...")) %
@@ -67,6 +187,7 @@ TdbDatabase::TdbDatabase(const string& id,
         }
     }
 
+    CNF_TRACE_SCOPE(PHASE_DB_OPEN);
     if (m_readonly) {
         m_tdbFile = tdb_open(m_databaseName.c_str(), 512, 0, O_RDONLY, 0);
     } else {
@@ -80,32 +201,53 @@ TdbDatabase::TdbDatabase(const string& id,
         message += m_databaseName;
         throw DatabaseException(CONNECT_ERROR, message);
     }
+
+    // Catalogs written by older versions lack the command index, whether
+    // they have the package index or not. It is started from all of their
+    // commands on the first update, see collectCommands().
+    m_commandIndex = has(COMMAND_INDEX);
 }
 
 TdbDatabase::~TdbDatabase() {
     if (m_tdbFile) {
+        if (!m_readonly) {
+            flush();
+        }
         tdb_close(m_tdbFile);
     }
     m_tdbFile = nullptr;
 }
 
-void TdbDatabase::storePackage(const Package& p) {
+string TdbDatabase::fetch(const string& key) const {
     TdbKeyValue kv;
+    kv.setKey(key);
+    kv.setValue(traced_fetch(m_tdbFile, kv.key()));
+    return kv.value_str();
+}
 
-    // check if this package is already indexed
-    kv.setKey(p.name() + "-version");
-    kv.setValue(tdb_fetch(m_tdbFile, kv.key()));
+bool TdbDatabase::has(const string& key) const {
+    TdbKeyValue kv;
+    kv.setKey(key);
+    return tdb_exists(m_tdbFile, kv.key()) != 0;
+}
 
-    if (kv.value_str() == p.version()) {
-        kv.setKey(p.name() + "-release");
-        kv.setValue(tdb_fetch(m_tdbFile, kv.key()));
-        if (kv.value_str() == p.release()) {
-            return;
-        }
+void TdbDatabase::store(const string& key, const string& value) {
+    TdbKeyValue kv(key, value);
+    tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_REPLACE);
+}
+
+bool TdbDatabase::storePackageInfo(const Package& p) {
+    // also for packages that are already indexed, older catalogs lack the
+    // package index
+    m_pendingPackages.insert(p.name());
+
+    if (hasPackage(p)) {
+        return false;
     }
 
     // OK, we have something new
 
+    TdbKeyValue kv;
     int res = 0;
 
     kv.setKey(p.name() + "-version");
@@ -136,63 +278,85 @@ void TdbDatabase::storePackage(const Package& p) {
         tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_INSERT);
     }
 
-    string filesString;
-    bool first = true;
+    kv.setKey(p.name() + "-files");
+    kv.setValue(join(p.files()));
+    res = tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_MODIFY);
+    if (res != 0) {
+        tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_INSERT);
+    }
+    return true;
+}
 
-    for (const auto& elem : p.files()) {
-        TdbKeyValue fkv(elem, p.name());
-
-        const int ret =
-            tdb_store(m_tdbFile, fkv.key(), fkv.value(), TDB_INSERT);
-
-        if (ret != 0) {
-            fkv.setValue(tdb_fetch(m_tdbFile, fkv.key()));
-            vector<string> others;
-            istringstream iss(fkv.value_str());
-            copy(istream_iterator<string>(iss), istream_iterator<string>(),
-                 back_inserter<vector<string>>(others));
-            others.push_back(p.name());
-
-            auto uIter = unique(others.begin(), others.end());
-            others.resize(uIter - others.begin());
-
-            string newValue;
-            bool isthefirst = true;
-            for (auto& other : others) {
-                if (isthefirst) {
-                    isthefirst = false;
-                } else {
-                    newValue += " ";
-                }
-                newValue += other;
-            }
+bool TdbDatabase::hasPackage(const Package& p) const {
+    TdbKeyValue kv;
+    kv.setKey(p.name() + "-version");
+    kv.setValue(tdb_fetch(m_tdbFile, kv.key()));
+    if (kv.value_str() != p.version()) {
+        return false;
+    }
 
-            fkv.setValue(newValue);
+    kv.setKey(p.name() + "-release");
+    kv.setValue(tdb_fetch(m_tdbFile, kv.key()));
+    return kv.value_str() == p.release();
+}
 
-            tdb_store(m_tdbFile, fkv.key(), fkv.value(), TDB_MODIFY);
-        }
+void TdbDatabase::storePackage(const Package& p) {
+    if (!storePackageInfo(p)) {
+        return;
+    }
 
-        if (first) {
-            filesString.append(elem);
-            first = false;
-        } else {
-            filesString.append(" " + elem);
-        }
+    // Rewriting the owners of every command for every package is quadratic
+    // in the number of providers, so they are collected and merged once per
+    // command in flushOwners().
+    for (const auto& elem : p.files()) {
+        m_pendingOwners[elem].push_back(p.name());
     }
+    m_pendingOwnerCount += p.files().size();
+    if (m_pendingOwnerCount >= OWNER_FLUSH_THRESHOLD) {
+        flushOwners();
+    }
+}
 
-    kv.setKey(p.name() + "-files");
-    kv.setValue(filesString);
-    res = tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_MODIFY);
-    if (res != 0) {
-        tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_INSERT);
+void TdbDatabase::storeOwners(const string& command,
+                              const vector<string>& packages) {
+    vector<string> owners = split(fetch(command));
+    // lists written by older versions are neither sorted nor unique
+    if (!is_sorted(owners.begin(), owners.end())) {
+        sort(owners.begin(), owners.end());
     }
+    owners.erase(unique(owners.begin(), owners.end()), owners.end());
+
+    vector<string> added(packages);
+    sort(added.begin(), added.end());
+    added.erase(unique(added.begin(), added.end()), added.end());
+
+    vector<string> merged;
+    merged.reserve(owners.size() + added.size());
+    set_union(owners.begin(), owners.end(), added.begin(), added.end(),
+              back_inserter(merged));
+    store(command, join(merged));
+    m_pendingCommands.push_back(command);
+}
+
+void TdbDatabase::flushOwners() {
+    for (const auto& elem : m_pendingOwners) {
+        storeOwners(elem.first, elem.second);
+    }
+    m_pendingOwners.clear();
+    m_pendingOwnerCount = 0;
 }
 
 void TdbDatabase::getPackages(const string& search,
                               vector<Package>& result) const {
+    CNF_TRACE_COUNT(COUNTER_PROBES, 1);
+
+    if (search.empty() || search[0] == '@') {
+        return;
+    }
+
     TdbKeyValue name_kv;
     name_kv.setKey(search);
-    name_kv.setValue(tdb_fetch(m_tdbFile, name_kv.key()));
+    name_kv.setValue(traced_fetch(m_tdbFile, name_kv.key()));
 
     vector<string> package_names;
     istringstream iss(name_kv.value_str());
@@ -200,38 +364,484 @@ void TdbDatabase::getPackages(const string& search,
          back_inserter<vector<string>>(package_names));
 
     for (auto& package_name : package_names) {
-        TdbKeyValue version_kv;
-        version_kv.setKey(package_name + "-version");
-        version_kv.setValue(tdb_fetch(m_tdbFile, version_kv.key()));
+        getPackage(package_name, result);
+    }
+}
 
-        TdbKeyValue release_kv;
-        release_kv.setKey(package_name + "-release");
-        release_kv.setValue(tdb_fetch(m_tdbFile, release_kv.key()));
+void TdbDatabase::getPackage(const string& package_name,
+                             vector<Package>& result) const {
+    TdbKeyValue version_kv;
+    version_kv.setKey(package_name + "-version");
+    version_kv.setValue(traced_fetch(m_tdbFile, version_kv.key()));
 
-        TdbKeyValue arch_kv;
-        arch_kv.setKey(package_name + "-architecture");
-        arch_kv.setValue(tdb_fetch(m_tdbFile, arch_kv.key()));
+    if (version_kv.value().dptr == nullptr) {
+        return;
+    }
+
+    TdbKeyValue release_kv;
+    release_kv.setKey(package_name + "-release");
+    release_kv.setValue(traced_fetch(m_tdbFile, release_kv.key()));
 
-        TdbKeyValue compression_kv;
-        compression_kv.setKey(package_name + "-compression");
-        compression_kv.setValue(tdb_fetch(m_tdbFile, compression_kv.key()));
+    TdbKeyValue arch_kv;
+    arch_kv.setKey(package_name + "-architecture");
+    arch_kv.setValue(traced_fetch(m_tdbFile, arch_kv.key()));
 
-        TdbKeyValue files_kv;
-        files_kv.setKey(package_name + "-files");
-        files_kv.setValue(tdb_fetch(m_tdbFile, files_kv.key()));
+    TdbKeyValue compression_kv;
+    compression_kv.setKey(package_name + "-compression");
+    compression_kv.setValue(traced_fetch(m_tdbFile, compression_kv.key()));
 
-        istringstream iss(files_kv.value_str());
-        vector<string> files;
-        copy(istream_iterator<string>(iss), istream_iterator<string>(),
-             back_inserter<vector<string>>(files));
+    TdbKeyValue files_kv;
+    files_kv.setKey(package_name + "-files");
+    files_kv.setValue(traced_fetch(m_tdbFile, files_kv.key()));
 
-        Package p(package_name, version_kv.value_str(), release_kv.value_str(),
-                  arch_kv.value_str(), compression_kv.value_str(), files);
-        result.push_back(p);
+    istringstream iss(files_kv.value_str());
+    vector<string> files;
+    copy(istream_iterator<string>(iss), istream_iterator<string>(),
+         back_inserter<vector<string>>(files));
+
+    result.emplace_back(package_name, version_kv.value_str(),
+                        release_kv.value_str(), arch_kv.value_str(),
+                        compression_kv.value_str(), move(files));
+}
+
+bool TdbDatabase::getCommands(vector<string>& result) const {
+    TdbKeyValue kv;
+    kv.setKey(COMMAND_INDEX);
+    kv.setValue(traced_fetch(m_tdbFile, kv.key()));
+    if (kv.value().dptr == nullptr) {
+        return false;
+    }
+    const vector<string> commands = split(kv.value_str());
+    result.insert(result.end(), commands.begin(), commands.end());
+    return true;
+}
+
+bool TdbDatabase::findCommands(const string& part,
+                               vector<string>& result) const {
+    TdbKeyValue kv;
+    kv.setKey(TRIGRAM_INDEX);
+    CommandQuery query{part, result};
+    CNF_TRACE_SCOPE(PHASE_DB_FETCH);
+    CNF_TRACE_COUNT(COUNTER_FETCHES, 1);
+    return tdb_parse_record(m_tdbFile, kv.key(), find_in_index, &query) == 0;
+}
+
+bool TdbDatabase::getWordModel(WordModel& model) const {
+    if (!has(LENGTH_INDEX)) {
+        return false;
+    }
+    for (const auto& elem : split(fetch(LENGTH_INDEX))) {
+        const size_t colon = elem.find(':');
+        if (colon != string::npos) {
+            model.add_length(strtoul(elem.c_str(), nullptr, 10),
+                             strtoull(elem.c_str() + colon + 1, nullptr, 10));
+        }
+    }
+    for (const auto& elem : split(fetch(BIGRAM_INDEX))) {
+        if (elem.size() == 4) {
+            const unsigned long pair = strtoul(elem.c_str(), nullptr, 16);
+            model.add_bigram(static_cast<char>(pair >> 8),
+                             static_cast<char>(pair & 0xff));
+        }
+    }
+    return true;
+}
+
+void TdbDatabase::storeWordModel(const WordModel& model) {
+    vector<string> lengths;
+    for (const auto& elem : model.lengths()) {
+        lengths.push_back(to_string(elem.first) + ":" +
+                          to_string(elem.second));
+    }
+    store(LENGTH_INDEX, join(lengths));
+
+    vector<string> bigrams;
+    for (const auto& elem : model.bigrams()) {
+        const unsigned pair =
+            static_cast<unsigned char>(elem.first) * 256u +
+            static_cast<unsigned char>(elem.second);
+        bigrams.push_back((format("%04x") % pair).str());
+    }
+    store(BIGRAM_INDEX, join(bigrams));
+}
+
+void TdbDatabase::findPackages(const string& pattern,
+                               vector<string>& result) const {
+    const string prefix = pattern.substr(0, pattern.find_first_of("*?[\\"));
+
+    const string chunks =
+        prefix.empty() ? fetch(PACKAGE_INDEX) : string(1, prefix[0]);
+
+    for (const char first : chunks) {
+        const string chunk = fetch(package_index_key(first));
+
+        vector<size_t> starts;
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            if (chunk[i] != ' ' && (i == 0 || chunk[i - 1] == ' ')) {
+                starts.push_back(i);
+            }
+        }
+
+        const auto word = [&chunk](const size_t start) {
+            return chunk.substr(start, chunk.find(' ', start) - start);
+        };
+
+        // the chunk is sorted, so all candidates follow the first name that
+        // is not smaller than the literal prefix
+        auto iter = lower_bound(starts.begin(), starts.end(), prefix,
+                                [&word](const size_t start, const string& p) {
+                                    return word(start) < p;
+                                });
+        for (; iter != starts.end(); ++iter) {
+            const string name = word(*iter);
+            if (name.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+            if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0) {
+                result.push_back(name);
+            }
+        }
+    }
+}
+
+void TdbDatabase::updateCommandIndex() {
+    sort(m_pendingCommands.begin(), m_pendingCommands.end());
+    m_pendingCommands.erase(
+        unique(m_pendingCommands.begin(), m_pendingCommands.end()),
+        m_pendingCommands.end());
+
+    // unless they got a new owner since
+    vector<string> removed;
+    for (const auto& command : m_removedCommands) {
+        if (!has(command)) {
+            removed.push_back(command);
+        }
+    }
+    sort(removed.begin(), removed.end());
+    removed.erase(unique(removed.begin(), removed.end()), removed.end());
+
+    const vector<string> commands = split(fetch(COMMAND_INDEX));
+    vector<string> added;
+    set_difference(m_pendingCommands.begin(), m_pendingCommands.end(),
+                   commands.begin(), commands.end(), back_inserter(added));
+    m_pendingCommands.clear();
+    m_removedCommands.clear();
+
+    if (added.empty() && removed.empty()) {
+        // catalogs written before the trigram index get it on their next
+        // update
+        if (!has(TRIGRAM_INDEX)) {
+            store(TRIGRAM_INDEX, TrigramIndex::build(commands));
+        }
+        return;
+    }
+
+    vector<string> kept;
+    set_difference(commands.begin(), commands.end(), removed.begin(),
+                   removed.end(), back_inserter(kept));
+    vector<string> merged;
+    merged.reserve(kept.size() + added.size());
+    set_union(kept.begin(), kept.end(), added.begin(), added.end(),
+              back_inserter(merged));
+    store(COMMAND_INDEX, join(merged));
+    store(TRIGRAM_INDEX, TrigramIndex::build(merged));
+
+    // removed commands stay in the model, which only makes it less selective
+    if (!added.empty()) {
+        WordModel model;
+        getWordModel(model);
+        for (const auto& command : added) {
+            model.add(command);
+        }
+        storeWordModel(model);
+    }
+}
+
+void TdbDatabase::scanCommands(vector<string>& result) const {
+    vector<string> keys;
+    tdb_traverse_read(m_tdbFile, collect_key, &keys);
+    const set<string> indexed = indexed_packages(keys);
+
+    for (auto& key : keys) {
+        if (key.empty() || key[0] == '@') {
+            continue;
+        }
+        bool is_field = false;
+        for (const char* field : PACKAGE_FIELDS) {
+            if (ends_with(key, field) &&
+                indexed.count(key.substr(0, key.size() - strlen(field))) !=
+                    0) {
+                is_field = true;
+                break;
+            }
+        }
+        if (!is_field) {
+            result.push_back(move(key));
+        }
+    }
+}
+
+void TdbDatabase::scanPackages(vector<string>& result) const {
+    vector<string> keys;
+    tdb_traverse_read(m_tdbFile, collect_key, &keys);
+    const set<string> indexed = indexed_packages(keys);
+    result.insert(result.end(), indexed.begin(), indexed.end());
+}
+
+void TdbDatabase::collectCommands() {
+    m_pendingCommands.clear();
+    m_removedCommands.clear();
+    scanCommands(m_pendingCommands);
+
+    // a word model without a command index is not trusted either
+    remove(LENGTH_INDEX);
+    remove(BIGRAM_INDEX);
+    remove(TRIGRAM_INDEX);
+    m_commandIndex = true;
+}
+
+void TdbDatabase::flush() {
+    flushOwners();
+
+    if (!m_pendingCommands.empty() || !m_removedCommands.empty()) {
+        if (!m_commandIndex) {
+            collectCommands();
+        }
+        updateCommandIndex();
+    }
+
+    if (m_pendingPackages.empty()) {
+        return;
+    }
+
+    map<char, vector<string>> chunks;
+    for (const auto& name : m_pendingPackages) {
+        chunks[name[0]].push_back(name);
+    }
+
+    string firsts = fetch(PACKAGE_INDEX);
+    for (const auto& chunk : chunks) {
+        vector<string> names = split(fetch(package_index_key(chunk.first)));
+        sort(names.begin(), names.end());
+
+        vector<string> merged;
+        merged.reserve(names.size() + chunk.second.size());
+        set_union(names.begin(), names.end(), chunk.second.begin(),
+                  chunk.second.end(), back_inserter(merged));
+        store(package_index_key(chunk.first), join(merged));
+
+        if (firsts.find(chunk.first) == string::npos) {
+            firsts += chunk.first;
+        }
+    }
+    sort(firsts.begin(), firsts.end());
+    store(PACKAGE_INDEX, firsts);
+
+    m_pendingPackages.clear();
+}
+
+GarbageStats TdbDatabase::removeStale(const set<string>& live) {
+    flush();
+
+    GarbageStats stats;
+
+    vector<string> keys;
+    tdb_traverse_read(m_tdbFile, collect_key, &keys);
+
+    const set<string> indexed = indexed_packages(keys);
+
+    // the commands the surviving packages provide right now
+    map<string, set<string>> provides;
+    for (const auto& name : indexed) {
+        if (live.count(name) != 0) {
+            const vector<string> files = split(fetch(name + "-files"));
+            provides[name].insert(files.begin(), files.end());
+        }
+    }
+
+    beginTransaction();
+    for (const auto& key : keys) {
+        if (key.empty() || key[0] == '@') {
+            continue;
+        }
+
+        bool is_field = false;
+        for (const char* field : PACKAGE_FIELDS) {
+            if (!ends_with(key, field)) {
+                continue;
+            }
+            const string name = key.substr(0, key.size() - strlen(field));
+            if (indexed.count(name) != 0) {
+                is_field = true;
+                if (live.count(name) == 0) {
+                    remove(key);
+                    if (field == PACKAGE_FIELDS[0]) {
+                        ++stats.packages;
+                    }
+                }
+                break;
+            }
+        }
+        if (is_field) {
+            continue;
+        }
+
+        const vector<string> owners = split(fetch(key));
+        vector<string> kept;
+        for (const auto& owner : owners) {
+            const auto iter = provides.find(owner);
+            if (iter != provides.end() && iter->second.count(key) != 0) {
+                kept.push_back(owner);
+            }
+        }
+        if (kept.size() != owners.size()) {
+            stats.owners += owners.size() - kept.size();
+            if (kept.empty()) {
+                remove(key);
+            } else {
+                store(key, join(kept));
+            }
+        }
+        if (!kept.empty()) {
+            m_pendingCommands.push_back(key);
+        }
+    }
+    // every command was visited, so the index can be rebuilt from scratch
+    remove(COMMAND_INDEX);
+    remove(LENGTH_INDEX);
+    remove(BIGRAM_INDEX);
+    remove(TRIGRAM_INDEX);
+    m_commandIndex = true;
+
+    // rebuild the package index from the survivors
+    for (const char first : fetch(PACKAGE_INDEX)) {
+        remove(package_index_key(first));
+    }
+    remove(PACKAGE_INDEX);
+    for (const auto& elem : provides) {
+        m_pendingPackages.insert(elem.first);
+    }
+    commitTransaction();
+
+    compact();
+    return stats;
+}
+
+bool TdbDatabase::removePackage(const string& name) {
+    if (name.empty() || !has(name + PACKAGE_FIELDS[0])) {
+        return false;
+    }
+    // owners buffered for the package would bring it back
+    flushOwners();
+
+    for (const auto& command : split(fetch(name + "-files"))) {
+        vector<string> owners = split(fetch(command));
+        owners.erase(std::remove(owners.begin(), owners.end(), name),
+                     owners.end());
+        if (owners.empty()) {
+            remove(command);
+            m_removedCommands.push_back(command);
+        } else {
+            store(command, join(owners));
+        }
+    }
+    for (const char* field : PACKAGE_FIELDS) {
+        remove(name + field);
+    }
+
+    m_pendingPackages.erase(name);
+    vector<string> names = split(fetch(package_index_key(name[0])));
+    names.erase(std::remove(names.begin(), names.end(), name), names.end());
+    if (!names.empty()) {
+        store(package_index_key(name[0]), join(names));
+    } else {
+        remove(package_index_key(name[0]));
+        string firsts = fetch(PACKAGE_INDEX);
+        firsts.erase(std::remove(firsts.begin(), firsts.end(), name[0]),
+                     firsts.end());
+        store(PACKAGE_INDEX, firsts);
+    }
+    return true;
+}
+
+void TdbDatabase::beginTransaction() {
+    if (tdb_transaction_start(m_tdbFile) != 0) {
+        string message;
+        message += translate("Error starting a transaction on tdb database: ");
+        message += m_databaseName;
+        throw DatabaseException(IO_ERROR, message);
+    }
+}
+
+void TdbDatabase::commitTransaction() {
+    flush();
+    if (tdb_transaction_commit(m_tdbFile) != 0) {
+        string message;
+        message += translate("Error committing tdb database: ");
+        message += m_databaseName;
+        throw DatabaseException(IO_ERROR, message);
+    }
+}
+
+void TdbDatabase::remove(const string& key) {
+    TdbKeyValue kv;
+    kv.setKey(key);
+    tdb_delete(m_tdbFile, kv.key());
+}
+
+void TdbDatabase::compact() {
+    // tdb never gives space back to the file system, so the records are
+    // copied into a fresh file that replaces the catalog
+    const string compacted = m_databaseName + ".compact";
+    TDB_CONTEXT* to =
+        tdb_open(compacted.c_str(), 512, 0, O_RDWR | O_CREAT | O_TRUNC,
+                 S_IRWXU | S_IRGRP | S_IROTH);
+    if (to == nullptr) {
+        string message;
+        message += translate("Error opening tdb database: ");
+        message += compacted;
+        throw DatabaseException(CONNECT_ERROR, message);
+    }
+
+    const bool copied = tdb_traverse_read(m_tdbFile, copy_record, to) >= 0;
+    tdb_close(to);
+    if (!copied) {
+        bf::remove(compacted);
+        string message;
+        message += translate("Error compacting tdb database: ");
+        message += m_databaseName;
+        throw DatabaseException(IO_ERROR, message);
+    }
+
+    tdb_close(m_tdbFile);
+    boost::system::error_code ec;
+    bf::rename(compacted, m_databaseName, ec);
+    // the catalog is reopened either way, compacted or not
+    m_tdbFile = tdb_open(m_databaseName.c_str(), 512, 0, O_RDWR,
+                         S_IRWXU | S_IRGRP | S_IROTH);
+    if (ec) {
+        bf::remove(compacted, ec);
+        string message;
+        message += translate("Error compacting tdb database: ");
+        message += m_databaseName;
+        throw DatabaseException(IO_ERROR, message);
+    }
+    if (m_tdbFile == nullptr) {
+        string message;
+        message += translate("Error opening tdb database: ");
+        message += m_databaseName;
+        throw DatabaseException(CONNECT_ERROR, message);
     }
 }
 
 void TdbDatabase::truncate() {
+    m_pendingPackages.clear();
+    m_pendingOwners.clear();
+    m_pendingOwnerCount = 0;
+    m_pendingCommands.clear();
+    m_removedCommands.clear();
+    m_commandIndex = true;
+
     if (m_tdbFile) {
         tdb_close(m_tdbFile);
     }
@@ -250,6 +860,18 @@ void TdbDatabase::truncate() {
 
 void TdbDatabase::getCatalogs(const string& database_path,
                               vector<string>& result) {
+    Manifest manifest;
+    if (manifest.read(database_path)) {
+        for (const auto& catalog : manifest.catalogs()) {
+            result.push_back(catalog.name);
+        }
+        return;
+    }
+    scanCatalogs(database_path, result);
+}
+
+void TdbDatabase::scanCatalogs(const string& database_path,
+                               vector<string>& result) {
     const bf::path p(database_path);
 
     if (bf::is_directory(p)) {
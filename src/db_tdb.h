@@ -19,7 +19,9 @@
 #ifndef TDB_H_
 #define TDB_H_
 
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <fcntl.h>
@@ -35,16 +37,63 @@ public:
                          bool readonly,
                          const std::string& base_path);
     void storePackage(const Package& p) override;
+    bool storePackageInfo(const Package& p) override;
+    bool hasPackage(const Package& p) const override;
+    void storeOwners(const std::string& command,
+                     const std::vector<std::string>& packages) override;
     void getPackages(const std::string& search,
                      std::vector<Package>& result) const override;
+    void getPackage(const std::string& name,
+                    std::vector<Package>& result) const override;
+    bool getCommands(std::vector<std::string>& result) const override;
+    void scanCommands(std::vector<std::string>& result) const override;
+    bool findCommands(const std::string& part,
+                      std::vector<std::string>& result) const override;
+    bool getWordModel(WordModel& model) const override;
+    void findPackages(const std::string& pattern,
+                      std::vector<std::string>& result) const override;
+    void scanPackages(std::vector<std::string>& result) const override;
+    void flush() override;
+    GarbageStats removeStale(const std::set<std::string>& live) override;
+    bool removePackage(const std::string& name) override;
+    void beginTransaction() override;
+    void commitTransaction() override;
     void truncate() override;
     ~TdbDatabase() override;
     static void getCatalogs(const std::string& database_path,
                             std::vector<std::string>& result);
+    // getCatalogs() without trying the manifest first
+    static void scanCatalogs(const std::string& database_path,
+                             std::vector<std::string>& result);
 
 private:
+    std::string fetch(const std::string& key) const;
+    bool has(const std::string& key) const;
+    void store(const std::string& key, const std::string& value);
+    void remove(const std::string& key);
+    void flushOwners();
+    void storeWordModel(const WordModel& model);
+    void updateCommandIndex();
+    // Queue all commands of the catalog for a command index started from
+    // scratch.
+    void collectCommands();
+    void compact();
+
+    // (command, package) pairs buffered before owners are flushed
+    static const size_t OWNER_FLUSH_THRESHOLD = 1 << 18;
+
     TDB_CONTEXT* m_tdbFile;
     const std::string m_databaseName;
+    std::set<std::string> m_pendingPackages;
+    std::unordered_map<std::string, std::vector<std::string>> m_pendingOwners;
+    size_t m_pendingOwnerCount;
+    // commands written since the last flush, for the command index
+    std::vector<std::string> m_pendingCommands;
+    // commands that lost their last owner since the last flush
+    std::vector<std::string> m_removedCommands;
+    // whether the command index and the word model cover all commands and
+    // are to be kept up to date
+    bool m_commandIndex;
 };
 
 class TdbKeyValue {
@@ -0,0 +1,255 @@
+#include "db_tdb.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+cnf::Package provider(const int i, const std::string& version = "1.0") {
+    const std::string name = "provider" + std::to_string(i);
+    return cnf::Package(name, version, "1", "x86_64", "xz",
+                        {"python", name + "-bin"});
+}
+
+std::vector<std::string> owners(const cnf::Database& db,
+                                 const std::string& command) {
+    std::vector<cnf::Package> packages;
+    db.getPackages(command, packages);
+    std::vector<std::string> names;
+    for (const auto& p : packages) {
+        names.push_back(p.name());
+    }
+    return names;
+}
+
+}  // namespace
+
+TEST_CASE("db_tdb::many_providers") {
+    TempDir dir;
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+
+    for (int i = 0; i < 500; ++i) {
+        db.storePackage(provider(i));
+    }
+    // an upgrade of an indexed package must not add it twice
+    db.storePackage(provider(7, "2.0"));
+    db.flush();
+
+    const auto names = owners(db, "python");
+    CHECK(names.size() == 500);
+    CHECK(std::is_sorted(names.begin(), names.end()));
+    CHECK(std::adjacent_find(names.begin(), names.end()) == names.end());
+    CHECK(owners(db, "provider7-bin") ==
+          std::vector<std::string>(1, "provider7"));
+}
+
+TEST_CASE("db_tdb::merge_with_existing_owners") {
+    TempDir dir;
+    {
+        cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+        for (int i = 0; i < 300; ++i) {
+            db.storePackage(provider(i));
+        }
+    }
+
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+    for (int i = 200; i < 600; ++i) {
+        db.storePackage(provider(i, "2.0"));
+    }
+    db.flush();
+
+    const auto names = owners(db, "python");
+    CHECK(names.size() == 600);
+    CHECK(std::adjacent_find(names.begin(), names.end()) == names.end());
+}
+
+TEST_CASE("db_tdb::store_owners") {
+    TempDir dir;
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+    db.storePackage(provider(1));
+    db.storePackage(provider(2));
+    db.flush();
+
+    db.storeOwners("python", {"provider2", "provider1", "provider2"});
+    CHECK(owners(db, "python") ==
+          std::vector<std::string>({"provider1", "provider2"}));
+}
+
+TEST_CASE("db_tdb::remove_stale") {
+    TempDir dir;
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+    for (int i = 0; i < 10; ++i) {
+        db.storePackage(provider(i));
+    }
+    db.flush();
+
+    std::set<std::string> live;
+    for (int i = 0; i < 10; i += 2) {
+        live.insert("provider" + std::to_string(i));
+    }
+    const auto stats = db.removeStale(live);
+    CHECK(stats.packages == 5);
+    CHECK(stats.owners == 10);
+
+    CHECK(owners(db, "python").size() == 5);
+    CHECK(owners(db, "provider3-bin").empty());
+
+    std::vector<std::string> names;
+    db.findPackages("*", names);
+    CHECK(names == std::vector<std::string>(live.begin(), live.end()));
+}
+
+TEST_CASE("db_tdb::command_index") {
+    TempDir dir;
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+    for (int i = 0; i < 3; ++i) {
+        db.storePackage(provider(i));
+    }
+    db.flush();
+
+    std::vector<std::string> commands;
+    CHECK(db.getCommands(commands));
+    CHECK(commands == std::vector<std::string>({"provider0-bin",
+                                                "provider1-bin",
+                                                "provider2-bin", "python"}));
+
+    cnf::WordModel model;
+    CHECK(db.getWordModel(model));
+    CHECK(model.lengths() ==
+          std::map<size_t, uint64_t>({{6, 1}, {13, 3}}));
+    CHECK(model.has_bigram(cnf::WordModel::BOUNDARY, 'p'));
+    CHECK(model.has_bigram('-', 'b'));
+    CHECK(!model.has_bigram('b', '-'));
+
+    db.removeStale({"provider1"});
+    commands.clear();
+    CHECK(db.getCommands(commands));
+    CHECK(commands ==
+          std::vector<std::string>({"provider1-bin", "python"}));
+
+    cnf::WordModel rebuilt;
+    CHECK(db.getWordModel(rebuilt));
+    CHECK(rebuilt.lengths() ==
+          std::map<size_t, uint64_t>({{6, 1}, {13, 1}}));
+}
+
+TEST_CASE("db_tdb::find_commands") {
+    TempDir dir;
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+    for (int i = 0; i < 3; ++i) {
+        db.storePackage(provider(i));
+    }
+    db.flush();
+
+    std::vector<std::string> commands;
+    CHECK(db.findCommands("r1-b", commands));
+    CHECK(commands == std::vector<std::string>({"provider1-bin"}));
+    commands.clear();
+    CHECK(db.findCommands("-bin", commands));
+    CHECK(commands == std::vector<std::string>({"provider0-bin",
+                                                "provider1-bin",
+                                                "provider2-bin"}));
+
+    db.removePackage("provider0");
+    db.flush();
+    commands.clear();
+    CHECK(db.findCommands("-bin", commands));
+    CHECK(commands == std::vector<std::string>({"provider1-bin",
+                                                "provider2-bin"}));
+
+    db.removeStale({"provider2"});
+    commands.clear();
+    CHECK(db.findCommands("th", commands));
+    CHECK(commands == std::vector<std::string>({"python"}));
+    commands.clear();
+    CHECK(db.findCommands("-bin", commands));
+    CHECK(commands == std::vector<std::string>({"provider2-bin"}));
+}
+
+TEST_CASE("db_tdb::command_index_of_old_catalog") {
+    TempDir dir;
+    {
+        cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+        for (int i = 0; i < 2; ++i) {
+            db.storePackage(provider(i));
+        }
+    }
+    // as written before the command and package indexes
+    const std::string file = (dir.path / "core-x86_64.tdb").string();
+    TDB_CONTEXT* tdb = tdb_open(file.c_str(), 512, 0, O_RDWR, 0);
+    REQUIRE(tdb != nullptr);
+    for (const std::string key : {"@commands", "@lengths", "@bigrams",
+                                  "@trigrams", "@packages", "@packages:p"}) {
+        TDB_DATA data;
+        data.dptr = reinterpret_cast<unsigned char*>(
+            const_cast<char*>(key.c_str()));
+        data.dsize = key.size() + 1;
+        tdb_delete(tdb, data);
+    }
+    tdb_close(tdb);
+
+    cnf::TdbDatabase db("core-x86_64", false, dir.path.string());
+    std::vector<std::string> commands;
+    CHECK(!db.getCommands(commands));
+    CHECK(!db.findCommands("-bin", commands));
+    std::vector<std::string> packages;
+    db.findPackages("*", packages);
+    CHECK(packages.empty());
+    db.scanPackages(packages);
+    CHECK(packages ==
+          std::vector<std::string>({"provider0", "provider1"}));
+    db.scanCommands(commands);
+    std::sort(commands.begin(), commands.end());
+    CHECK(commands == std::vector<std::string>(
+                          {"provider0-bin", "provider1-bin", "python"}));
+    commands.clear();
+
+    db.storePackage(provider(2));
+    db.flush();
+
+    CHECK(db.getCommands(commands));
+    CHECK(commands == std::vector<std::string>({"provider0-bin",
+                                                "provider1-bin",
+                                                "provider2-bin", "python"}));
+    commands.clear();
+    CHECK(db.findCommands("0-b", commands));
+    CHECK(commands == std::vector<std::string>({"provider0-bin"}));
+
+    cnf::WordModel model;
+    CHECK(db.getWordModel(model));
+    CHECK(model.lengths() ==
+          std::map<size_t, uint64_t>({{6, 1}, {13, 3}}));
+}
+
+TEST_CASE("db_tdb::result_map") {
+    // core-x86_64 and core-i686 both fold into "core"
+    cnf::ResultMap result;
+    result.insert("core", {cnf::Package("foo", "1.0", "1", "x86_64", "xz",
+                                        {"foo"}),
+                           cnf::Package("bar", "1.0", "1", "x86_64", "xz",
+                                        {"foo"})});
+    result.insert("core", {cnf::Package("foo", "1.0", "1", "i686", "xz",
+                                        {"foo"})});
+    result.insert("extra", {cnf::Package("foo", "1.0", "1", "i686", "xz",
+                                         {"foo"})});
+
+    REQUIRE(result.size() == 2);
+    const auto& core = result.begin()->second;
+    REQUIRE(core.size() == 2);
+    CHECK(core[0].name() == "bar");
+    CHECK(core[1].name() == "foo");
+    CHECK(core[1].architecture() == "x86_64");
+    CHECK((result.begin() + 1)->second.size() == 1);
+}
@@ -0,0 +1,46 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DEADLINE_H_
+#define DEADLINE_H_
+
+#include <chrono>
+
+namespace cnf {
+
+// A point in time after which lookups return what they found so far.
+// Default constructed deadlines never expire.
+class Deadline {
+public:
+    Deadline() : m_limited(false), m_end() {}
+    explicit Deadline(const std::chrono::milliseconds budget)
+        : m_limited(true), m_end(std::chrono::steady_clock::now() + budget) {}
+
+    bool limited() const { return m_limited; }
+    bool expired() const {
+        return m_limited && std::chrono::steady_clock::now() >= m_end;
+    }
+
+private:
+    bool m_limited;
+    std::chrono::steady_clock::time_point m_end;
+};
+
+}  // namespace cnf
+
+#endif /* DEADLINE_H_ */
@@ -0,0 +1,222 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "custom_exceptions.h"
+#include "db.h"
+#include "executor.h"
+
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+// terms per work unit: large enough to amortize the scheduling, small enough
+// to balance the similar_words() candidates of a long input
+const size_t UNIT_TERMS = 256;
+
+struct Unit {
+    size_t catalog;
+    size_t begin;
+    size_t end;
+    // (term index, packages) for the terms that found something
+    vector<pair<size_t, vector<Package>>> hits;
+};
+
+struct Catalog {
+    mutex lock;  // held while a unit of this catalog runs
+    shared_ptr<Database> db;
+    bool failed = false;
+};
+
+struct Queue {
+    mutex lock;
+    deque<size_t> units;
+};
+
+class Executor {
+public:
+    Executor(const string& database_path,
+             const vector<string>& catalogs,
+             const vector<string>& terms,
+             const unsigned threads,
+             const Deadline& deadline)
+        : m_databasePath(database_path)
+        , m_catalogNames(catalogs)
+        , m_terms(terms)
+        , m_deadline(deadline)
+        , m_catalogs(catalogs.size())
+        , m_expired(false) {
+        for (size_t catalog = 0; catalog < catalogs.size(); ++catalog) {
+            for (size_t begin = 0; begin < terms.size(); begin += UNIT_TERMS) {
+                m_units.push_back(Unit{catalog, begin,
+                                       min(begin + UNIT_TERMS, terms.size()),
+                                       {}});
+            }
+        }
+
+        const size_t workers =
+            max<size_t>(1, min<size_t>(threads, m_units.size()));
+        m_queues = vector<Queue>(workers);
+
+        // whole catalogs per worker to start with, keeps the handles busy
+        for (size_t unit = 0; unit < m_units.size(); ++unit) {
+            m_queues[m_units[unit].catalog % workers].units.push_back(unit);
+        }
+    }
+
+    bool run(vector<CatalogHits>& hits) {
+        vector<thread> pool;
+        for (size_t worker = 1; worker < m_queues.size(); ++worker) {
+            pool.emplace_back(&Executor::work, this, worker);
+        }
+        work(0);
+        for (auto& t : pool) {
+            t.join();
+        }
+
+        // merge in unit order, which does not depend on the scheduling
+        hits.assign(m_catalogs.size(), CatalogHits());
+        for (auto& unit : m_units) {
+            for (auto& hit : unit.hits) {
+                CatalogHits& target = hits[unit.catalog];
+                target.terms.push_back(m_terms[hit.first]);
+                move(hit.second.begin(), hit.second.end(),
+                     back_inserter(target.packages));
+            }
+        }
+        return !m_expired;
+    }
+
+private:
+    void work(const size_t self) {
+        size_t unit = 0;
+        while (!m_expired) {
+            if (pop(self, unit)) {
+                unique_lock<mutex> lock(m_catalogs[m_units[unit].catalog].lock);
+                execute(m_units[unit]);
+            } else if (steal(self, unit)) {
+                // steal() returns with the catalog locked
+                unique_lock<mutex> lock(m_catalogs[m_units[unit].catalog].lock,
+                                        adopt_lock);
+                execute(m_units[unit]);
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool pop(const size_t self, size_t& unit) {
+        Queue& queue = m_queues[self];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.units.empty()) {
+            return false;
+        }
+        unit = queue.units.front();
+        queue.units.pop_front();
+        return true;
+    }
+
+    // Take a unit from the back of another queue, but only one whose catalog
+    // is idle; the others are left to their owners.
+    bool steal(const size_t self, size_t& unit) {
+        for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+            Queue& queue = m_queues[(self + offset) % m_queues.size()];
+            lock_guard<mutex> guard(queue.lock);
+            for (auto iter = queue.units.rbegin(); iter != queue.units.rend();
+                 ++iter) {
+                if (m_catalogs[m_units[*iter].catalog].lock.try_lock()) {
+                    unit = *iter;
+                    queue.units.erase(next(iter).base());
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void execute(Unit& unit) {
+        Catalog& catalog = m_catalogs[unit.catalog];
+        if (catalog.failed) {
+            return;
+        }
+        if (m_deadline.expired()) {
+            m_expired = true;
+            return;
+        }
+        if (!catalog.db) {
+            try {
+                catalog.db = getDatabase(m_catalogNames[unit.catalog], true,
+                                         m_databasePath);
+            } catch (const DatabaseException& e) {
+                catalog.failed = true;
+                lock_guard<mutex> guard(m_outputLock);
+                cerr << e.what() << endl;
+                return;
+            }
+        }
+
+        for (size_t term = unit.begin; term < unit.end; ++term) {
+            if (m_deadline.expired()) {
+                m_expired = true;
+                return;
+            }
+            vector<Package> packages;
+            catalog.db->getPackages(m_terms[term], packages);
+            if (!packages.empty()) {
+                unit.hits.emplace_back(term, move(packages));
+            }
+        }
+    }
+
+    const string& m_databasePath;
+    const vector<string>& m_catalogNames;
+    const vector<string>& m_terms;
+    const Deadline& m_deadline;
+
+    vector<Unit> m_units;
+    vector<Catalog> m_catalogs;
+    vector<Queue> m_queues;
+    atomic<bool> m_expired;
+    mutex m_outputLock;
+};
+
+}  // namespace
+
+bool probe_catalogs(const string& database_path,
+                    const vector<string>& catalogs,
+                    const vector<string>& terms,
+                    const unsigned threads,
+                    const Deadline& deadline,
+                    vector<CatalogHits>& hits) {
+    Executor executor(database_path, catalogs, terms, threads, deadline);
+    return executor.run(hits);
+}
+
+}  // namespace cnf
@@ -0,0 +1,53 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <string>
+#include <vector>
+
+#include "deadline.h"
+#include "package.h"
+
+namespace cnf {
+
+struct CatalogHits {
+    // in the order of the terms that found them
+    std::vector<Package> packages;
+    std::vector<std::string> terms;
+};
+
+// Probe every catalog for every term. The work is split into (catalog, term
+// range) units that are spread over a pool of threads with work stealing.
+// tdb refuses to open a file twice in one process, so each catalog has a
+// single read-only handle that is held exclusively while one of its units
+// runs; idle threads steal units of catalogs nobody is working on.
+//
+// hits is indexed like catalogs and independent of the scheduling. Returns
+// false if the deadline expired before all units were done.
+bool probe_catalogs(const std::string& database_path,
+                    const std::vector<std::string>& catalogs,
+                    const std::vector<std::string>& terms,
+                    unsigned threads,
+                    const Deadline& deadline,
+                    std::vector<CatalogHits>& hits);
+
+}  // namespace cnf
+
+#endif /* EXECUTOR_H_ */
@@ -0,0 +1,247 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "custom_exceptions.h"
+#include "db.h"
+#include "external_sort.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+// runs merged at once, bounded to stay clear of the open file limit
+const size_t MAX_FAN_IN = 64;
+
+// rough heap footprint of a buffered pair besides the characters
+const size_t PAIR_OVERHEAD = sizeof(pair<string, string>) + 32;
+
+const size_t STREAM_BUFFER = 1 << 16;
+
+// numbers the runs of all sorters, several may share a spill directory
+atomic<size_t> run_counter(0);
+
+struct RunReader {
+    ifstream in;
+    unique_ptr<char[]> buffer;
+    string key;
+    string value;
+
+    bool next() {
+        string line;
+        if (!getline(in, line)) {
+            return false;
+        }
+        const size_t tab = line.find('\t');
+        key.assign(line, 0, tab);
+        value.assign(line, tab == string::npos ? line.size() : tab + 1,
+                     string::npos);
+        return true;
+    }
+};
+
+void throw_io_error(const bf::path& path) {
+    format message =
+        format(translate("could not access sort run: %s")) % path.string();
+    throw DatabaseException(IO_ERROR, message.str());
+}
+
+}  // namespace
+
+ExternalSorter::ExternalSorter(const bf::path& spill_directory,
+                               const size_t memory_limit)
+    : m_directory(spill_directory)
+    , m_memoryLimit(memory_limit)
+    , m_bufferBytes(0) {}
+
+ExternalSorter::~ExternalSorter() {
+    boost::system::error_code ec;
+    for (const auto& run : m_runs) {
+        bf::remove(run, ec);
+    }
+}
+
+void ExternalSorter::add(const string& key, const string& value) {
+    m_bufferBytes += key.size() + value.size() + PAIR_OVERHEAD;
+    m_buffer.emplace_back(key, value);
+    if (m_bufferBytes > m_memoryLimit) {
+        spill();
+    }
+}
+
+bf::path ExternalSorter::nextRun() {
+    return m_directory /
+           (format(".cnf-sort-%d-%d") % getpid() % run_counter++).str();
+}
+
+void ExternalSorter::spill() {
+    if (m_buffer.empty()) {
+        return;
+    }
+    sort(m_buffer.begin(), m_buffer.end());
+
+    const bf::path run = nextRun();
+    m_runs.push_back(run);
+
+    unique_ptr<char[]> buffer(new char[STREAM_BUFFER]);
+    ofstream out;
+    out.rdbuf()->pubsetbuf(buffer.get(), STREAM_BUFFER);
+    out.open(run.c_str(), ios::trunc | ios::out);
+    const pair<string, string>* last = nullptr;
+    for (const auto& elem : m_buffer) {
+        if (last == nullptr || *last != elem) {
+            out << elem.first << '\t' << elem.second << '\n';
+        }
+        last = &elem;
+    }
+    out.close();
+    if (!out) {
+        throw_io_error(run);
+    }
+
+    // release the memory, clear() would keep the capacity
+    vector<pair<string, string>>().swap(m_buffer);
+    m_bufferBytes = 0;
+}
+
+void ExternalSorter::mergeRuns(
+    const vector<bf::path>& runs,
+    const function<void(const string&, const string&)>& out) {
+    vector<RunReader> readers(runs.size());
+
+    using Head = pair<const RunReader*, size_t>;
+    const auto greater = [](const Head& lhs, const Head& rhs) {
+        if (lhs.first->key != rhs.first->key) {
+            return lhs.first->key > rhs.first->key;
+        }
+        return lhs.first->value > rhs.first->value;
+    };
+    priority_queue<Head, vector<Head>, decltype(greater)> heads(greater);
+
+    for (size_t i = 0; i < runs.size(); ++i) {
+        RunReader& reader = readers[i];
+        reader.buffer.reset(new char[STREAM_BUFFER]);
+        reader.in.rdbuf()->pubsetbuf(reader.buffer.get(), STREAM_BUFFER);
+        reader.in.open(runs[i].c_str());
+        if (!reader.in) {
+            throw_io_error(runs[i]);
+        }
+        if (reader.next()) {
+            heads.emplace(&reader, i);
+        }
+    }
+
+    string last_key, last_value;
+    bool first = true;
+    while (!heads.empty()) {
+        const size_t i = heads.top().second;
+        heads.pop();
+        RunReader& reader = readers[i];
+        if (first || reader.key != last_key || reader.value != last_value) {
+            out(reader.key, reader.value);
+            last_key = reader.key;
+            last_value = reader.value;
+            first = false;
+        }
+        if (reader.next()) {
+            heads.emplace(&reader, i);
+        }
+    }
+}
+
+void ExternalSorter::merge(const Sink& sink) {
+    string key;
+    vector<string> values;
+    const auto collect = [&](const string& k, const string& v) {
+        if (k != key && !values.empty()) {
+            sink(key, values);
+            values.clear();
+        }
+        key = k;
+        values.push_back(v);
+    };
+
+    if (m_runs.empty()) {
+        // everything fit into memory
+        sort(m_buffer.begin(), m_buffer.end());
+        m_buffer.erase(unique(m_buffer.begin(), m_buffer.end()),
+                       m_buffer.end());
+        for (const auto& elem : m_buffer) {
+            collect(elem.first, elem.second);
+        }
+        vector<pair<string, string>>().swap(m_buffer);
+        m_bufferBytes = 0;
+    } else {
+        spill();
+
+        // reduce the number of runs until they can be merged in one pass
+        while (m_runs.size() > MAX_FAN_IN) {
+            const vector<bf::path> inputs(m_runs.begin(),
+                                          m_runs.begin() + MAX_FAN_IN);
+            const bf::path run = nextRun();
+            {
+                unique_ptr<char[]> buffer(new char[STREAM_BUFFER]);
+                ofstream out;
+                out.rdbuf()->pubsetbuf(buffer.get(), STREAM_BUFFER);
+                out.open(run.c_str(), ios::trunc | ios::out);
+                mergeRuns(inputs, [&out](const string& k, const string& v) {
+                    out << k << '\t' << v << '\n';
+                });
+                out.close();
+                if (!out) {
+                    throw_io_error(run);
+                }
+            }
+            for (const auto& input : inputs) {
+                bf::remove(input);
+            }
+            m_runs.erase(m_runs.begin(), m_runs.begin() + MAX_FAN_IN);
+            m_runs.push_back(run);
+        }
+
+        mergeRuns(m_runs, collect);
+        for (const auto& run : m_runs) {
+            bf::remove(run);
+        }
+        m_runs.clear();
+    }
+
+    if (!values.empty()) {
+        sink(key, values);
+    }
+}
+
+}  // namespace cnf
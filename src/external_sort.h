@@ -0,0 +1,71 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXTERNAL_SORT_H_
+#define EXTERNAL_SORT_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace cnf {
+
+// Sorts (key, value) pairs that do not fit into memory. Pairs are buffered
+// until the buffer exceeds the memory limit, then sorted and spilled to a
+// run file in the spill directory. merge() combines the runs with a k-way
+// merge. Keys and values must not contain tabs or newlines.
+class ExternalSorter {
+public:
+    using Sink = std::function<void(const std::string& key,
+                                    const std::vector<std::string>& values)>;
+
+    ExternalSorter(const boost::filesystem::path& spill_directory,
+                   size_t memory_limit);
+    ~ExternalSorter();
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    void add(const std::string& key, const std::string& value);
+
+    // Call sink once per key in ascending order with the sorted, unique
+    // values of that key. The sorter is empty afterwards.
+    void merge(const Sink& sink);
+
+    size_t runs() const { return m_runs.size(); }
+
+private:
+    void spill();
+    boost::filesystem::path nextRun();
+    void mergeRuns(const std::vector<boost::filesystem::path>& runs,
+                   const std::function<void(const std::string&,
+                                            const std::string&)>& out);
+
+    const boost::filesystem::path m_directory;
+    const size_t m_memoryLimit;
+    size_t m_bufferBytes;
+    std::vector<std::pair<std::string, std::string>> m_buffer;
+    std::vector<boost::filesystem::path> m_runs;
+};
+
+}  // namespace cnf
+
+#endif /* EXTERNAL_SORT_H_ */
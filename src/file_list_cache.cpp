@@ -0,0 +1,161 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <boost/locale.hpp>
+
+#include "custom_exceptions.h"
+#include "db.h"
+#include "db_tdb.h"
+#include "file_list_cache.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+int collect_key(TDB_CONTEXT* /*tdb*/,
+                TDB_DATA key,
+                TDB_DATA /*value*/,
+                void* keys) {
+    static_cast<vector<string>*>(keys)->emplace_back(
+        reinterpret_cast<const char*>(key.dptr));
+    return 0;
+}
+
+}  // namespace
+
+FileListCache::FileListCache(const string& path)
+    : m_tdbFile(nullptr), m_hits(0), m_misses(0) {
+    m_tdbFile = tdb_open(path.c_str(), 512, 0, O_RDWR | O_CREAT,
+                         S_IRWXU | S_IRGRP | S_IROTH);
+    if (m_tdbFile == nullptr) {
+        string message;
+        message += translate("Error opening tdb database: ");
+        message += path;
+        throw DatabaseException(CONNECT_ERROR, message);
+    }
+}
+
+FileListCache::~FileListCache() {
+    if (m_tdbFile) {
+        tdb_close(m_tdbFile);
+    }
+    m_tdbFile = nullptr;
+}
+
+string FileListCache::default_path(const string& database_path) {
+    return (bf::path(database_path) / "file-lists.cache").string();
+}
+
+string FileListCache::key(const bf::path& package) {
+    return package.filename().string() + ":" +
+           to_string(bf::file_size(package)) + ":" +
+           to_string(bf::last_write_time(package));
+}
+
+bool FileListCache::get(const bf::path& package, vector<string>& files) {
+    TdbKeyValue kv;
+    try {
+        kv.setKey(key(package));
+    } catch (const bf::filesystem_error&) {
+        return false;
+    }
+    kv.setValue(tdb_fetch(m_tdbFile, kv.key()));
+    // packages without commands have an empty, but existing record
+    if (kv.value().dptr == nullptr) {
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    m_used.insert(kv.key_str());
+
+    istringstream iss(kv.value_str());
+    copy(istream_iterator<string>(iss), istream_iterator<string>(),
+         back_inserter(files));
+    return true;
+}
+
+void FileListCache::put(const bf::path& package, const vector<string>& files) {
+    string value;
+    for (const auto& file : files) {
+        if (!value.empty()) {
+            value += " ";
+        }
+        value += file;
+    }
+
+    try {
+        TdbKeyValue kv(key(package), value);
+        tdb_store(m_tdbFile, kv.key(), kv.value(), TDB_REPLACE);
+        m_used.insert(kv.key_str());
+    } catch (const bf::filesystem_error&) {
+        // the package is gone, nothing worth caching
+    }
+}
+
+bool FileListCache::contains(const bf::path& package) {
+    TdbKeyValue kv;
+    try {
+        kv.setKey(key(package));
+    } catch (const bf::filesystem_error&) {
+        return false;
+    }
+    if (tdb_exists(m_tdbFile, kv.key()) == 0) {
+        return false;
+    }
+    m_used.insert(kv.key_str());
+    return true;
+}
+
+void FileListCache::keep(const bf::path& package) {
+    try {
+        m_used.insert(key(package));
+    } catch (const bf::filesystem_error&) {
+        // the package is gone, so is its entry
+    }
+}
+
+size_t FileListCache::prune() {
+    vector<string> keys;
+    tdb_traverse_read(m_tdbFile, collect_key, &keys);
+
+    size_t removed = 0;
+    for (const auto& key : keys) {
+        if (m_used.count(key) == 0) {
+            TdbKeyValue kv;
+            kv.setKey(key);
+            tdb_delete(m_tdbFile, kv.key());
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+}  // namespace cnf
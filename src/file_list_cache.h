@@ -0,0 +1,76 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FILE_LIST_CACHE_H_
+#define FILE_LIST_CACHE_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <tdb.h>
+
+namespace cnf {
+
+// The commands of package files, kept across catalogs and populate runs in
+// a tdb file. Entries are keyed by the file name, size and modification time
+// of a package, so an "any" package indexed for every architecture, or the
+// same file in several repositories or mirror snapshots, is only read once.
+class FileListCache {
+public:
+    // throws DatabaseException if the file can not be opened
+    explicit FileListCache(const std::string& path);
+    FileListCache(const FileListCache&) = delete;
+    FileListCache& operator=(const FileListCache&) = delete;
+    ~FileListCache();
+
+    // next to the catalogs, but not named like one
+    static std::string default_path(const std::string& database_path);
+
+    bool get(const boost::filesystem::path& package,
+             std::vector<std::string>& files);
+    void put(const boost::filesystem::path& package,
+             const std::vector<std::string>& files);
+    // get() would succeed; marks the entry as used like get()
+    bool contains(const boost::filesystem::path& package);
+    // Marks the entry of a package file as used although it is not read,
+    // e.g. because the package is indexed already.
+    void keep(const boost::filesystem::path& package);
+
+    // Removes the entries that were not used or kept since the cache was
+    // opened. Returns their number.
+    size_t prune();
+
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+
+private:
+    static std::string key(const boost::filesystem::path& package);
+
+    TDB_CONTEXT* m_tdbFile;
+    std::unordered_set<std::string> m_used;
+    size_t m_hits;
+    size_t m_misses;
+};
+
+}  // namespace cnf
+
+#endif /* FILE_LIST_CACHE_H_ */
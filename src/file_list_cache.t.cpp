@@ -0,0 +1,116 @@
+#include "file_list_cache.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "db.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+bf::path package(const bf::path& dir, const std::string& name) {
+    const bf::path path = dir / name;
+    std::ofstream(path.string()) << name;
+    return path;
+}
+
+}  // namespace
+
+TEST_CASE("file_list_cache::round_trip") {
+    TempDir dir;
+    const bf::path a = package(dir.path, "a-1.0-1-any.pkg.tar.xz");
+    const bf::path b = package(dir.path, "b-1.0-1-any.pkg.tar.xz");
+
+    {
+        cnf::FileListCache cache(cnf::FileListCache::default_path(
+            dir.path.string()));
+        std::vector<std::string> files;
+        CHECK(!cache.get(a, files));
+        cache.put(a, {"ls", "dir"});
+        cache.put(b, {});
+    }
+
+    cnf::FileListCache cache(
+        cnf::FileListCache::default_path(dir.path.string()));
+    std::vector<std::string> files;
+    CHECK(cache.get(a, files));
+    CHECK(files == std::vector<std::string>({"ls", "dir"}));
+
+    // packages without commands are cached as well
+    files.clear();
+    CHECK(cache.get(b, files));
+    CHECK(files.empty());
+    CHECK(cache.hits() == 2);
+}
+
+TEST_CASE("file_list_cache::changed_file") {
+    TempDir dir;
+    const bf::path a = package(dir.path, "a-1.0-1-any.pkg.tar.xz");
+
+    cnf::FileListCache cache(
+        cnf::FileListCache::default_path(dir.path.string()));
+    cache.put(a, {"ls"});
+    bf::last_write_time(a, bf::last_write_time(a) - 60);
+
+    std::vector<std::string> files;
+    CHECK(!cache.get(a, files));
+    CHECK(cache.misses() == 1);
+}
+
+TEST_CASE("file_list_cache::prune") {
+    TempDir dir;
+    const bf::path a = package(dir.path, "a-1.0-1-any.pkg.tar.xz");
+    const bf::path b = package(dir.path, "b-1.0-1-any.pkg.tar.xz");
+    const std::string path =
+        cnf::FileListCache::default_path(dir.path.string());
+
+    {
+        cnf::FileListCache cache(path);
+        cache.put(a, {"ls"});
+        cache.put(b, {"dir"});
+    }
+    {
+        cnf::FileListCache cache(path);
+        std::vector<std::string> files;
+        CHECK(cache.get(a, files));
+        CHECK(cache.prune() == 1);
+    }
+
+    cnf::FileListCache cache(path);
+    std::vector<std::string> files;
+    CHECK(cache.get(a, files));
+    CHECK(!cache.get(b, files));
+}
+
+TEST_CASE("file_list_cache::mirror_runs") {
+    TempDir dir;
+    const bf::path packages = dir.path / "mirror" / "core" / "os" / "x86_64";
+    const bf::path database = dir.path / "db";
+    bf::create_directories(packages);
+    bf::create_directories(database);
+    for (const std::string name : {"a", "b"}) {
+        cnf::test::write_package(packages / (name + "-1.0-1-x86_64.pkg.tar.gz"),
+                                 {"usr/bin/" + name});
+    }
+
+    // the second run skips the indexed packages, their entries must still
+    // be there for the rebuild by the third
+    for (int run = 0; run < 3; ++run) {
+        cnf::PopulateOptions options;
+        options.file_lists = std::make_shared<cnf::FileListCache>(
+            cnf::FileListCache::default_path(database.string()));
+        cnf::populate_mirror(dir.path / "mirror", database.string(), run == 2,
+                             0, options);
+        CHECK(options.file_lists->misses() == (run == 0 ? 2 : 0));
+        CHECK(options.file_lists->hits() == (run == 2 ? 2 : 0));
+    }
+}
@@ -0,0 +1,272 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <unistd.h>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "formatter.h"
+#include "trace.h"
+
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+// a typical package entry, to size the buffer up front
+const size_t ENTRY_SIZE = 256;
+
+const char* const BOLD = "\033[1m";
+const char* const RESET = "\033[0m";
+const char* const HIGHLIGHT = "\033[0;31m";
+
+void append_json_string(string& out, const string& value) {
+    out += '"';
+    for (const char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+template <typename Predicate>
+void append_json_files(string& out,
+                       const vector<string>& files,
+                       const Predicate& include) {
+    out += '[';
+    bool first = true;
+    for (const auto& file : files) {
+        if (!include(file)) {
+            continue;
+        }
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        append_json_string(out, file);
+    }
+    out += ']';
+}
+
+size_t package_count(const ResultMap& result) {
+    size_t count = 0;
+    for (const auto& elem : result) {
+        count += elem.second.size();
+    }
+    return count;
+}
+
+}  // namespace
+
+bool parse_format(const string& name, OutputFormat& format) {
+    if (name == "text") {
+        format = FORMAT_TEXT;
+    } else if (name == "json") {
+        format = FORMAT_JSON;
+    } else if (name == "tsv") {
+        format = FORMAT_TSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ResultWriter::ResultWriter(const OutputFormat format, const bool colors)
+    : m_format(format), m_colors(colors && format == FORMAT_TEXT) {}
+
+void ResultWriter::add(const string& heading,
+                       const string& query,
+                       const string& kind,
+                       const ResultMap& result,
+                       const vector<string>& highlights,
+                       const bool partial) {
+    CNF_TRACE_SCOPE(PHASE_FORMAT);
+
+    m_buffer.reserve(m_buffer.size() + heading.size() +
+                     package_count(result) * ENTRY_SIZE);
+
+    switch (m_format) {
+        case FORMAT_TEXT:
+            addText(heading, result, highlights);
+            break;
+        case FORMAT_JSON:
+            addJson(query, kind, result, highlights, partial);
+            break;
+        case FORMAT_TSV:
+            addTsv(result, highlights);
+            break;
+    }
+}
+
+void ResultWriter::addText(const string& heading,
+                           const ResultMap& result,
+                           const vector<string>& highlights) {
+    const unordered_set<string> hl(highlights.begin(), highlights.end());
+
+    m_buffer += heading;
+    m_buffer += '\n';
+
+    // translated and parsed once, not per package
+    format origin(translate(" (%s-%s) from %s").str());
+    for (const auto& elem : result) {
+        for (const auto& package : elem.second) {
+            if (m_colors) {
+                m_buffer += BOLD;
+                m_buffer += package.name();
+                m_buffer += RESET;
+            } else {
+                m_buffer += package.name();
+            }
+            origin.clear();
+            m_buffer += (origin % package.version() % package.release() %
+                         elem.first)
+                            .str();
+            m_buffer += '\n';
+            package.hl_append(m_buffer, hl, "\t", m_colors ? HIGHLIGHT : "");
+            m_buffer += '\n';
+        }
+    }
+}
+
+void ResultWriter::addJson(const string& query,
+                           const string& kind,
+                           const ResultMap& result,
+                           const vector<string>& highlights,
+                           const bool partial) {
+    const unordered_set<string> hl(highlights.begin(), highlights.end());
+
+    m_buffer += "{\"query\":";
+    append_json_string(m_buffer, query);
+    m_buffer += ",\"kind\":";
+    append_json_string(m_buffer, kind);
+    m_buffer += partial ? ",\"partial\":true" : ",\"partial\":false";
+    m_buffer += ",\"packages\":[";
+
+    bool first = true;
+    for (const auto& elem : result) {
+        for (const auto& package : elem.second) {
+            if (!first) {
+                m_buffer += ',';
+            }
+            first = false;
+            m_buffer += "{\"repository\":";
+            append_json_string(m_buffer, elem.first);
+            m_buffer += ",\"name\":";
+            append_json_string(m_buffer, package.name());
+            m_buffer += ",\"version\":";
+            append_json_string(m_buffer, package.version());
+            m_buffer += ",\"release\":";
+            append_json_string(m_buffer, package.release());
+            m_buffer += ",\"matches\":";
+            append_json_files(m_buffer, package.files(),
+                              [&hl](const string& f) { return hl.count(f); });
+            m_buffer += ",\"files\":";
+            append_json_files(m_buffer, package.files(),
+                              [](const string&) { return true; });
+            m_buffer += '}';
+        }
+    }
+    m_buffer += "]}\n";
+}
+
+void ResultWriter::addTsv(const ResultMap& result,
+                          const vector<string>& highlights) {
+    const unordered_set<string> hl(highlights.begin(), highlights.end());
+
+    for (const auto& elem : result) {
+        for (const auto& package : elem.second) {
+            m_buffer += elem.first;
+            m_buffer += '\t';
+            m_buffer += package.name();
+            m_buffer += '\t';
+            m_buffer += package.version();
+            m_buffer += '\t';
+            m_buffer += package.release();
+            m_buffer += '\t';
+            bool first = true;
+            for (const auto& file : package.files()) {
+                if (hl.count(file) != 0) {
+                    if (!first) {
+                        m_buffer += ' ';
+                    }
+                    first = false;
+                    m_buffer += file;
+                }
+            }
+            m_buffer += '\t';
+            first = true;
+            for (const auto& file : package.files()) {
+                if (!first) {
+                    m_buffer += ' ';
+                }
+                first = false;
+                m_buffer += file;
+            }
+            m_buffer += '\n';
+        }
+    }
+}
+
+bool ResultWriter::flush(const int fd) {
+    const char* data = m_buffer.data();
+    size_t left = m_buffer.size();
+    while (left > 0) {
+        const ssize_t written = write(fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        left -= written;
+    }
+    m_buffer.clear();
+    return true;
+}
+
+}  // namespace cnf
@@ -0,0 +1,77 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FORMATTER_H_
+#define FORMATTER_H_
+
+#include <string>
+#include <vector>
+
+#include "db.h"
+
+namespace cnf {
+
+enum OutputFormat { FORMAT_TEXT, FORMAT_JSON, FORMAT_TSV };
+
+// Parse the value of --format; returns false for unknown formats.
+bool parse_format(const std::string& name, OutputFormat& format);
+
+// Renders lookup results into one preallocated buffer that is written out
+// with a single write(2).
+//
+// FORMAT_TEXT is the translated, human readable listing. FORMAT_JSON emits
+// one object {"query", "kind", "partial", "packages": [{"repository",
+// "name", "version", "release", "matches", "files"}]}. FORMAT_TSV emits one
+// line per package: repository, name, version, release, matching commands
+// and all commands, the latter two separated by spaces.
+class ResultWriter {
+public:
+    ResultWriter(OutputFormat format, bool colors);
+
+    // kind is "command", "similar", "contains", "package" or "path"; heading
+    // is only used for FORMAT_TEXT
+    void add(const std::string& heading,
+             const std::string& query,
+             const std::string& kind,
+             const ResultMap& result,
+             const std::vector<std::string>& highlights,
+             bool partial);
+
+    // Write the buffer to fd; returns false on errors.
+    bool flush(int fd);
+
+private:
+    void addText(const std::string& heading,
+                 const ResultMap& result,
+                 const std::vector<std::string>& highlights);
+    void addJson(const std::string& query,
+                 const std::string& kind,
+                 const ResultMap& result,
+                 const std::vector<std::string>& highlights,
+                 bool partial);
+    void addTsv(const ResultMap& result,
+                const std::vector<std::string>& highlights);
+
+    const OutputFormat m_format;
+    const bool m_colors;
+    std::string m_buffer;
+};
+
+}  // namespace cnf
+
+#endif /* FORMATTER_H_ */
@@ -0,0 +1,269 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define CNF_AVX2_KERNEL 1
+#endif
+
+#include "fuzzy_scan.h"
+
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+// Myers' algorithm keeps one column of the DP matrix as bit vectors, so the
+// query must fit into a machine word.
+const size_t MAX_PATTERN = 64;
+
+// Per character, the positions it has in the query, which is at most
+// MAX_PATTERN characters long.
+struct Pattern {
+    explicit Pattern(const string& query) : size(query.size()), peq() {
+        assert(query.size() <= MAX_PATTERN);
+        for (size_t i = 0; i < query.size(); ++i) {
+            peq[static_cast<unsigned char>(query[i])] |= uint64_t(1) << i;
+        }
+    }
+
+    size_t size;
+    uint64_t peq[256];
+};
+
+// Distances of query to count names of length n that are stored back to back
+// in text (Hyyrö's formulation for the global edit distance).
+void scan_scalar(const Pattern& p,
+                 const char* text,
+                 const size_t n,
+                 const size_t count,
+                 unsigned* distances) {
+    const uint64_t high = uint64_t(1) << (p.size - 1);
+
+    for (size_t name = 0; name < count; ++name, text += n) {
+        uint64_t pv = ~uint64_t(0);
+        uint64_t mv = 0;
+        unsigned score = p.size;
+        for (size_t j = 0; j < n; ++j) {
+            const uint64_t eq = p.peq[static_cast<unsigned char>(text[j])];
+            const uint64_t xv = eq | mv;
+            const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+            if (ph & high) {
+                ++score;
+            } else if (mh & high) {
+                --score;
+            }
+            // the first row grows by one per text character
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        distances[name] = score;
+    }
+}
+
+#ifdef CNF_AVX2_KERNEL
+// scan_scalar() for four names at once, one per 64 bit lane; returns the
+// number of names done, the rest is left to the caller.
+__attribute__((target("avx2"))) size_t scan_avx2(const Pattern& p,
+                                                 const char* text,
+                                                 const size_t n,
+                                                 const size_t count,
+                                                 unsigned* distances) {
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i high = _mm256_set1_epi64x(int64_t(uint64_t(1)
+                                                    << (p.size - 1)));
+    const auto eq_at = [&p](const char* name) {
+        return p.peq[static_cast<unsigned char>(*name)];
+    };
+
+    size_t name = 0;
+    for (; name + 4 <= count; name += 4) {
+        const char* t = text + name * n;
+        __m256i pv = ones;
+        __m256i mv = _mm256_setzero_si256();
+        __m256i score = _mm256_set1_epi64x(p.size);
+        for (size_t j = 0; j < n; ++j, ++t) {
+            const __m256i eq = _mm256_set_epi64x(eq_at(t + 3 * n),
+                                                 eq_at(t + 2 * n),
+                                                 eq_at(t + n), eq_at(t));
+            const __m256i xv = _mm256_or_si256(eq, mv);
+            const __m256i sum =
+                _mm256_add_epi64(_mm256_and_si256(eq, pv), pv);
+            const __m256i xh =
+                _mm256_or_si256(_mm256_xor_si256(sum, pv), eq);
+            __m256i ph = _mm256_or_si256(
+                mv, _mm256_xor_si256(_mm256_or_si256(xh, pv), ones));
+            __m256i mh = _mm256_and_si256(pv, xh);
+            // the comparisons yield -1 per lane where the bit is set; ph
+            // and mh never both have it
+            score = _mm256_sub_epi64(
+                score,
+                _mm256_cmpeq_epi64(_mm256_and_si256(ph, high), high));
+            score = _mm256_add_epi64(
+                score,
+                _mm256_cmpeq_epi64(_mm256_and_si256(mh, high), high));
+            ph = _mm256_or_si256(_mm256_slli_epi64(ph, 1), one);
+            mh = _mm256_slli_epi64(mh, 1);
+            pv = _mm256_or_si256(
+                mh, _mm256_xor_si256(_mm256_or_si256(xv, ph), ones));
+            mv = _mm256_and_si256(ph, xv);
+        }
+
+        alignas(32) int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), score);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            distances[name + lane] = static_cast<unsigned>(lanes[lane]);
+        }
+    }
+    return name;
+}
+
+bool have_avx2() {
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+#endif
+
+void scan(const Pattern& p,
+          const char* text,
+          const size_t n,
+          const size_t count,
+          unsigned* distances) {
+    size_t done = 0;
+#ifdef CNF_AVX2_KERNEL
+    if (have_avx2()) {
+        done = scan_avx2(p, text, n, count, distances);
+    }
+#endif
+    scan_scalar(p, text + done * n, n, count - done, distances + done);
+}
+
+// The plain dynamic programming distance for queries too long for scan().
+unsigned distance(const string& a, const char* b, const size_t n) {
+    vector<unsigned> row(n + 1);
+    for (size_t j = 0; j <= n; ++j) {
+        row[j] = j;
+    }
+    for (size_t i = 1; i <= a.size(); ++i) {
+        unsigned diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= n; ++j) {
+            const unsigned above = row[j];
+            row[j] = min({above + 1, row[j - 1] + 1,
+                          diagonal + (a[i - 1] == b[j - 1] ? 0u : 1u)});
+            diagonal = above;
+        }
+    }
+    return row[n];
+}
+
+}  // namespace
+
+CommandDictionary::CommandDictionary(vector<string> names) : m_size(0) {
+    sort(names.begin(), names.end());
+    names.erase(unique(names.begin(), names.end()), names.end());
+
+    // names are appended in order, which keeps every bucket sorted
+    for (const auto& name : names) {
+        if (name.empty()) {
+            continue;
+        }
+        if (name.size() >= m_buckets.size()) {
+            m_buckets.resize(name.size() + 1);
+        }
+        m_buckets[name.size()] += name;
+        ++m_size;
+    }
+}
+
+vector<FuzzyMatch> CommandDictionary::search(const string& query,
+                                             const unsigned max_distance,
+                                             const size_t limit,
+                                             const Deadline& deadline) const {
+    vector<FuzzyMatch> result;
+    if (query.empty() || limit == 0 || m_buckets.empty()) {
+        return result;
+    }
+
+    const size_t m = query.size();
+    // longer queries are compared by distance() instead
+    unique_ptr<const Pattern> pattern;
+    if (m <= MAX_PATTERN) {
+        pattern.reset(new Pattern(query));
+    }
+    const size_t shortest = m > max_distance ? m - max_distance : 1;
+    const size_t longest = min(m + max_distance, m_buckets.size() - 1);
+
+    vector<unsigned> distances;
+    for (size_t n = shortest; n <= longest; ++n) {
+        if (deadline.expired()) {
+            break;
+        }
+        const string& bucket = m_buckets[n];
+        const size_t count = bucket.size() / n;
+        if (count == 0) {
+            continue;
+        }
+
+        distances.resize(count);
+        if (pattern) {
+            scan(*pattern, bucket.data(), n, count, distances.data());
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                distances[i] = distance(query, bucket.data() + i * n, n);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (distances[i] <= max_distance) {
+                result.push_back(
+                    FuzzyMatch{bucket.substr(i * n, n), distances[i]});
+            }
+        }
+    }
+
+    const auto nearer = [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        return a.distance != b.distance ? a.distance < b.distance
+                                        : a.name < b.name;
+    };
+    if (result.size() > limit) {
+        partial_sort(result.begin(), result.begin() + limit, result.end(),
+                     nearer);
+        result.resize(limit);
+    } else {
+        sort(result.begin(), result.end(), nearer);
+    }
+    return result;
+}
+
+}  // namespace cnf
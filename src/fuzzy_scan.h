@@ -0,0 +1,62 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FUZZY_SCAN_H_
+#define FUZZY_SCAN_H_
+
+#include <string>
+#include <vector>
+
+#include "deadline.h"
+
+namespace cnf {
+
+struct FuzzyMatch {
+    std::string name;
+    unsigned distance;
+};
+
+// All command names of the catalogs, packed into one buffer per name length
+// and compared with a query by edit distance (Levenshtein). Instead of probing
+// the catalogs for every similar_words() candidate, the whole dictionary is
+// scanned with Myers' bit-parallel algorithm, four names at a time on CPUs
+// with AVX2.
+class CommandDictionary {
+public:
+    explicit CommandDictionary(std::vector<std::string> names);
+
+    // The names within max_distance edits of query, nearest first and by
+    // name among equally near ones, at most limit of them. Stops scanning
+    // when the deadline expires.
+    std::vector<FuzzyMatch> search(const std::string& query,
+                                   unsigned max_distance,
+                                   size_t limit,
+                                   const Deadline& deadline = Deadline()) const;
+
+    size_t size() const { return m_size; }
+
+private:
+    // m_buckets[n] holds the names of length n back to back
+    std::vector<std::string> m_buckets;
+    size_t m_size;
+};
+
+}  // namespace cnf
+
+#endif /* FUZZY_SCAN_H_ */
@@ -0,0 +1,112 @@
+#include "fuzzy_scan.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "test_util.h"
+
+namespace {
+
+using cnf::test::random_word;
+
+// a small alphabet, so that there are many near words
+const char LAST_LETTER = 'e';
+
+unsigned levenshtein(const std::string& a, const std::string& b) {
+    std::vector<std::vector<unsigned>> d(a.size() + 1,
+                                         std::vector<unsigned>(b.size() + 1));
+    for (size_t i = 0; i <= a.size(); ++i) {
+        d[i][0] = i;
+    }
+    for (size_t j = 0; j <= b.size(); ++j) {
+        d[0][j] = j;
+    }
+    for (size_t i = 1; i <= a.size(); ++i) {
+        for (size_t j = 1; j <= b.size(); ++j) {
+            d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1,
+                                d[i - 1][j - 1] + (a[i - 1] != b[j - 1])});
+        }
+    }
+    return d[a.size()][b.size()];
+}
+
+std::vector<std::string> names(const std::vector<cnf::FuzzyMatch>& matches) {
+    std::vector<std::string> result;
+    for (const auto& match : matches) {
+        result.push_back(match.name);
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("fuzzy_scan::matches_dynamic_programming") {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> length(1, 12);
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 2000; ++i) {
+        words.push_back(random_word(rng, length(rng), LAST_LETTER));
+    }
+    const cnf::CommandDictionary dictionary(words);
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    CHECK(dictionary.size() == words.size());
+
+    for (int i = 0; i < 50; ++i) {
+        const std::string query = random_word(rng, length(rng), LAST_LETTER);
+        for (const unsigned k : {0u, 1u, 2u, 3u}) {
+            std::vector<cnf::FuzzyMatch> expected;
+            for (const auto& word : words) {
+                const unsigned d = levenshtein(query, word);
+                if (d <= k) {
+                    expected.push_back(cnf::FuzzyMatch{word, d});
+                }
+            }
+            std::stable_sort(expected.begin(), expected.end(),
+                             [](const cnf::FuzzyMatch& a,
+                                const cnf::FuzzyMatch& b) {
+                                 return a.distance < b.distance;
+                             });
+
+            const auto found = dictionary.search(query, k, words.size());
+            REQUIRE(found.size() == expected.size());
+            for (size_t j = 0; j < found.size(); ++j) {
+                CHECK(found[j].name == expected[j].name);
+                CHECK(found[j].distance == expected[j].distance);
+            }
+        }
+    }
+}
+
+TEST_CASE("fuzzy_scan::long_query") {
+    // longer than the bit-parallel pattern, Pattern asserts on these
+    const std::string base(70, 'x');
+    const cnf::CommandDictionary dictionary(
+        {base, base + "y", "y" + base.substr(1), base.substr(3)});
+
+    const auto found = dictionary.search(base, 2, 10);
+    CHECK(names(found) ==
+          std::vector<std::string>(
+              {base, base + "y", "y" + base.substr(1)}));
+    CHECK(found[2].distance == 1);
+}
+
+TEST_CASE("fuzzy_scan::ranking_and_limit") {
+    const cnf::CommandDictionary dictionary(
+        {"gti", "git", "gitk", "gt", "tig", "ls", "git", "", "gitg"});
+
+    CHECK(names(dictionary.search("git", 2, 20)) ==
+          std::vector<std::string>(
+              {"git", "gitg", "gitk", "gt", "gti", "tig"}));
+    CHECK(names(dictionary.search("git", 1, 3)) ==
+          std::vector<std::string>({"git", "gitg", "gitk"}));
+    CHECK(dictionary.search("git", 2, 0).empty());
+    CHECK(dictionary.search("", 2, 20).empty());
+    CHECK(cnf::CommandDictionary({}).search("git", 2, 20).empty());
+}
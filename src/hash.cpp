@@ -0,0 +1,215 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "custom_exceptions.h"
+#include "hash.h"
+#include "package.h"
+
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(const uint64_t x, const int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t xxh_round(uint64_t acc, const uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+inline uint64_t merge_round(uint64_t acc, const uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+// consume as many 32 byte stripes as possible, return the bytes consumed
+inline size_t consume_stripes(uint64_t* acc,
+                              const unsigned char* p,
+                              const size_t size) {
+    const unsigned char* const begin = p;
+    const unsigned char* const limit = p + (size & ~size_t(31));
+    uint64_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+    while (p < limit) {
+        v1 = xxh_round(v1, read64(p));
+        v2 = xxh_round(v2, read64(p + 8));
+        v3 = xxh_round(v3, read64(p + 16));
+        v4 = xxh_round(v4, read64(p + 24));
+        p += 32;
+    }
+    acc[0] = v1;
+    acc[1] = v2;
+    acc[2] = v3;
+    acc[3] = v4;
+    return p - begin;
+}
+
+}  // namespace
+
+Hasher::Hasher(const uint64_t seed)
+    : m_acc{seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1}
+    , m_seed(seed)
+    , m_totalSize(0)
+    , m_buffer()
+    , m_bufferSize(0) {}
+
+void Hasher::update(const void* data, size_t size) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    m_totalSize += size;
+
+    if (m_bufferSize > 0) {
+        const size_t fill = min(size, sizeof(m_buffer) - m_bufferSize);
+        memcpy(m_buffer + m_bufferSize, p, fill);
+        m_bufferSize += fill;
+        p += fill;
+        size -= fill;
+        if (m_bufferSize < sizeof(m_buffer)) {
+            return;
+        }
+        consume_stripes(m_acc, m_buffer, sizeof(m_buffer));
+        m_bufferSize = 0;
+    }
+
+    const size_t consumed = consume_stripes(m_acc, p, size);
+    p += consumed;
+    size -= consumed;
+
+    memcpy(m_buffer, p, size);
+    m_bufferSize = size;
+}
+
+uint64_t Hasher::digest() const {
+    uint64_t h;
+    if (m_totalSize >= 32) {
+        h = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) +
+            rotl(m_acc[3], 18);
+        for (const auto v : m_acc) {
+            h = merge_round(h, v);
+        }
+    } else {
+        h = m_seed + PRIME5;
+    }
+
+    h += m_totalSize;
+
+    const unsigned char* p = m_buffer;
+    const unsigned char* const end = m_buffer + m_bufferSize;
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= uint64_t(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t hash_bytes(const void* data, const size_t size, const uint64_t seed) {
+    Hasher hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+uint64_t hash_file(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw InvalidArgumentException(
+            MISSING_FILE, (format(translate("could not open: %s")) % path).str());
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    Hasher hasher;
+    vector<unsigned char> buffer(1 << 20);
+    ssize_t got = 0;
+    while ((got = read(fd, buffer.data(), buffer.size())) > 0) {
+        hasher.update(buffer.data(), got);
+    }
+    close(fd);
+
+    if (got < 0) {
+        throw InvalidArgumentException(
+            INVALID_FILE, (format(translate("could not read: %s")) % path).str());
+    }
+    return hasher.digest();
+}
+
+string hash_to_string(const uint64_t hash) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx",
+             static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+bool hash_from_string(const string& str, uint64_t& hash) {
+    if (str.size() != 16 ||
+        str.find_first_not_of("0123456789abcdef") != string::npos) {
+        return false;
+    }
+    hash = stoull(str, nullptr, 16);
+    return true;
+}
+
+}  // namespace cnf
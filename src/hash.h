@@ -0,0 +1,55 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cnf {
+
+// Streaming XXH64, compatible with the reference implementation.
+class Hasher {
+public:
+    explicit Hasher(uint64_t seed = 0);
+
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    uint64_t m_acc[4];
+    uint64_t m_seed;
+    uint64_t m_totalSize;
+    unsigned char m_buffer[32];
+    size_t m_bufferSize;
+};
+
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Hash the content of a file; throws InvalidArgumentException if it cannot
+// be read.
+uint64_t hash_file(const std::string& path);
+
+std::string hash_to_string(uint64_t hash);
+bool hash_from_string(const std::string& str, uint64_t& hash);
+
+}  // namespace cnf
+
+#endif /* HASH_H_ */
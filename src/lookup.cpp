@@ -16,21 +16,26 @@
     along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
 #include <map>
 #include <set>
-#include <sstream>
 #include <string>
 #include <vector>
 
 #include <getopt.h>
+#include <unistd.h>
 #include <boost/format.hpp>
 #include <boost/locale.hpp>
 
 #include "config.h"
 #include "db.h"
+#include "formatter.h"
 #include "package.h"
+#include "prewarm.h"
+#include "trace.h"
 
 using namespace cnf;
 using namespace std;
@@ -41,19 +46,63 @@ static struct args_t {
     string database_path;
     bool colors;
     int verbosity;
+    bool trace;
+    bool cache;
+    unsigned threads;
+    long timeout_ms;
+    FuzzyBackend fuzzy;
+    unsigned max_distance;
+    size_t max_matches;
+    OutputFormat format;
+    string package_pattern;
+    string path;
+    string contains;
     string search_string;
+    bool prewarm;
+    long lock_mb;
 } args;
 
-static const char* OPT_STRING = "d:cvh?";
+static const char* OPT_STRING = "d:ctnj:T:z:D:K:o:p:f:s:wL:vh?";
 
 static const struct option LONG_OPTS[] = {
     {"database-path", required_argument, nullptr, 'd'},
     {"colors", no_argument, nullptr, 'c'},
+    {"trace", no_argument, nullptr, 't'},
+    {"no-cache", no_argument, nullptr, 'n'},
+    {"threads", required_argument, nullptr, 'j'},
+    {"timeout-ms", required_argument, nullptr, 'T'},
+    {"fuzzy", required_argument, nullptr, 'z'},
+    {"max-distance", required_argument, nullptr, 'D'},
+    {"max-matches", required_argument, nullptr, 'K'},
+    {"format", required_argument, nullptr, 'o'},
+    {"package", required_argument, nullptr, 'p'},
+    {"path", required_argument, nullptr, 'f'},
+    {"contains", required_argument, nullptr, 's'},
+    {"prewarm", no_argument, nullptr, 'w'},
+    {"lock", required_argument, nullptr, 'L'},
     {"verbose", no_argument, nullptr, 'v'},
     {"help", no_argument, nullptr, 'h'},
     {nullptr, no_argument, nullptr, 0}};
 
+// Setting up boost::locale and loading the message catalogs is the most
+// expensive part of the startup, so it is deferred until there is output.
+static void init_locale() {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    CNF_TRACE_SCOPE(PHASE_LOCALE);
+    boost::locale::generator gen;
+    gen.add_messages_path(LC_MESSAGE_PATH);
+    gen.add_messages_domain(PROGRAM_NAME);
+    locale::global(gen(""));
+    cout.imbue(locale());
+}
+
 void usage() {
+    init_locale();
     cout << format(translate("       *** %s %s ***                             "
                              "              \n")) %
                 PROGRAM_NAME % VERSION_LONG
@@ -63,6 +112,18 @@ void usage() {
          << translate(
                 "   cnf-lookup [ -d ] <search term>                            "
                 " \n")
+         << translate(
+                "   cnf-lookup [ -d ] --package <glob>                         "
+                " \n")
+         << translate(
+                "   cnf-lookup [ -d ] --path <file>                            "
+                " \n")
+         << translate(
+                "   cnf-lookup [ -d ] --contains <string>                      "
+                " \n")
+         << translate(
+                "   cnf-lookup [ -d ] --prewarm [ --lock <MiB> ]               "
+                " \n")
          << translate(
                 "                                                              "
                 " \n")
@@ -86,21 +147,168 @@ void usage() {
          << translate(
                 " --colors          -c        Pretty colored output            "
                 " \n")
+         << translate(
+                " --trace           -t        Print lookup timings to stderr   "
+                " \n"
+                "                             (also enabled by CNF_TRACE=1)    "
+                " \n")
+         << translate(
+                " --no-cache        -n        Do not use the shared result "
+                "cache\n")
+         << translate(
+                " --threads         -j        Number of threads probing the "
+                "catalogs\n")
+         << translate(
+                " --timeout-ms      -T        Give up after this many "
+                "milliseconds\n"
+                "                             and print what was found so far  "
+                " \n")
+         << translate(
+                " --fuzzy           -z        Find similar commands by: "
+                "candidates\n"
+                "                             (default) or scan of all names   "
+                " \n")
+         << translate(
+                " --max-distance    -D        Edit distance of the scanned "
+                "commands\n")
+         << translate(
+                " --max-matches     -K        Number of the nearest scanned "
+                "commands\n")
+         << translate(
+                " --format          -o        Output format: text (default), "
+                "json, tsv\n")
+         << translate(
+                " --package         -p        List the packages matching a "
+                "pattern  \n")
+         << translate(
+                " --path            -f        Show the packages providing a "
+                "file     \n")
+         << translate(
+                " --contains        -s        List the commands containing a "
+                "string,\n"
+                "                             as many as --max-matches         "
+                " \n")
+         << translate(
+                " --prewarm         -w        Read the catalogs into memory "
+                "and report\n"
+                "                             their resident size              "
+                " \n")
+         << translate(
+                " --lock            -L        With --prewarm: lock this many "
+                "MiB of\n"
+                "                             them in memory until terminated  "
+                " \n")
          << endl;
     exit(1);
 }
 
+// Locked pages are only kept while the process lives, so with --lock it
+// stays until it is terminated.
+static int prewarm() {
+    init_locale();
+    const Prewarmer prewarmer(args.database_path,
+                              static_cast<uint64_t>(args.lock_mb) << 20);
+    const PrewarmStats stats = prewarmer.stats();
+    cout << format(translate("Prewarmed %d files: %d of %d KiB resident, %d "
+                             "KiB locked")) %
+                stats.files % (stats.resident >> 10) % (stats.bytes >> 10) %
+                (stats.locked >> 10)
+         << endl;
+    if (stats.lock_failed) {
+        cerr << translate("Could not lock all of them, the limit for locked "
+                          "memory (RLIMIT_MEMLOCK) may be too low")
+             << endl;
+    }
+    if (args.lock_mb == 0 || stats.locked == 0) {
+        return stats.files > 0 ? 0 : 1;
+    }
+    for (;;) {
+        pause();
+    }
+}
+
+static bool parse_fuzzy(const string& name, FuzzyBackend& backend) {
+    if (name == "candidates") {
+        backend = FUZZY_CANDIDATES;
+    } else if (name == "scan") {
+        backend = FUZZY_SCAN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int finish(const int rc) {
+    if (args.trace) {
+        trace::report(cerr);
+    }
+    return rc;
+}
+
+static void print_partial() {
+    init_locale();
+    cerr << format(translate("Lookup timed out after %d ms, the result may be "
+                             "incomplete.")) %
+                args.timeout_ms
+         << endl;
+}
+
+// The heading of the text output; the locale is only set up for it.
+static string heading(const boost::locale::message& message,
+                      const string& arg) {
+    if (args.format != FORMAT_TEXT) {
+        return string();
+    }
+    init_locale();
+    return (format(message.str()) % arg).str();
+}
+
+static void print_result(const string& title,
+                         const string& query,
+                         const string& kind,
+                         const ResultMap& result,
+                         const vector<string>& highlights,
+                         const bool partial) {
+    ResultWriter writer(args.format, args.colors);
+    writer.add(title, query, kind, result, highlights, partial);
+    cout.flush();
+    writer.flush(STDOUT_FILENO);
+    if (partial && args.format == FORMAT_TEXT) {
+        print_partial();
+    }
+}
+
+// Machine readable formats always describe the lookup, even without match.
+static int not_found(const string& query,
+                     const string& kind,
+                     const bool partial) {
+    if (args.format == FORMAT_JSON) {
+        print_result(string(), query, kind, ResultMap(), vector<string>(),
+                     partial);
+    } else if (partial) {
+        print_partial();
+    }
+    return finish(1);
+}
+
 int main(int argc, char** argv) {
-    boost::locale::generator gen;
-    gen.add_messages_path(LC_MESSAGE_PATH);
-    gen.add_messages_domain(PROGRAM_NAME);
-    locale::global(gen(""));
-    cout.imbue(locale());
+    const char* trace_env = getenv("CNF_TRACE");
 
     args.database_path = DATABASE_PATH;
     args.colors = false;
     args.verbosity = 0;
+    args.trace = trace_env != nullptr && *trace_env != '\0' &&
+                 string(trace_env) != "0";
+    args.cache = true;
+    args.threads = 1;
+    args.timeout_ms = 0;
+    args.fuzzy = FUZZY_CANDIDATES;
+    args.max_distance = 2;
+    args.max_matches = 20;
+    args.format = FORMAT_TEXT;
     args.search_string = "";  // actually done implicit
+    args.prewarm = false;
+    args.lock_mb = 0;
 
     int opt(0), long_index(0);
 
@@ -113,6 +321,73 @@ int main(int argc, char** argv) {
             case 'c':
                 args.colors = true;
                 break;
+            case 't':
+                args.trace = true;
+                break;
+            case 'n':
+                args.cache = false;
+                break;
+            case 'j': {
+                const long threads = strtol(optarg, nullptr, 10);
+                if (threads < 1) {
+                    usage();
+                }
+                args.threads = static_cast<unsigned>(threads);
+                break;
+            }
+            case 'T':
+                args.timeout_ms = strtol(optarg, nullptr, 10);
+                if (args.timeout_ms < 0) {
+                    usage();
+                }
+                break;
+            case 'z':
+                if (!parse_fuzzy(optarg, args.fuzzy)) {
+                    usage();
+                }
+                break;
+            case 'D': {
+                const long distance = strtol(optarg, nullptr, 10);
+                if (distance < 0) {
+                    usage();
+                }
+                args.max_distance = static_cast<unsigned>(distance);
+                break;
+            }
+            case 'K': {
+                const long matches = strtol(optarg, nullptr, 10);
+                if (matches < 1) {
+                    usage();
+                }
+                args.max_matches = static_cast<size_t>(matches);
+                break;
+            }
+            case 'o':
+                if (!parse_format(optarg, args.format)) {
+                    usage();
+                }
+                break;
+            case 'p':
+                args.package_pattern = optarg;
+                break;
+            case 'f':
+                args.path = optarg;
+                break;
+            case 's':
+                args.contains = optarg;
+                if (args.contains.empty()) {
+                    usage();
+                }
+                break;
+            case 'w':
+                args.prewarm = true;
+                break;
+            case 'L':
+                args.lock_mb = strtol(optarg, nullptr, 10);
+                if (args.lock_mb <= 0) {
+                    usage();
+                }
+                break;
             case 'v':
                 args.verbosity++;
                 break;
@@ -126,78 +401,119 @@ int main(int argc, char** argv) {
         opt = getopt_long(argc, argv, OPT_STRING, LONG_OPTS, &long_index);
     }
 
-    if (argc - optind != 1) {
+    if (args.prewarm) {
+        if (argc - optind != 0 || !args.package_pattern.empty() ||
+            !args.path.empty() || !args.contains.empty()) {
+            usage();
+        }
+        return prewarm();
+    }
+    if (args.lock_mb > 0) {
+        usage();
+    }
+
+    const int modes = !args.package_pattern.empty() + !args.path.empty() +
+                      !args.contains.empty();
+
+    if (argc - optind != (modes > 0 ? 0 : 1) || modes > 1) {
         usage();
     }
 
-    args.search_string = argv[optind];
+    trace::enable(args.trace);
 
-    ResultMap result;
+    if (!args.package_pattern.empty()) {
+        ResultMap result;
+        lookup_packages(args.package_pattern, args.database_path, result);
+        if (result.empty()) {
+            return not_found(args.package_pattern, "package", false);
+        }
 
-    lookup(args.search_string, args.database_path, result);
+        print_result(heading(translate("The following packages match '%s':"),
+                             args.package_pattern),
+                     args.package_pattern, "package", result, vector<string>(),
+                     false);
+        return finish(0);
+    }
 
-    stringstream out;
+    LookupOptions options;
+    options.use_cache = args.cache;
+    options.threads = args.threads;
+    options.fuzzy = args.fuzzy;
+    options.max_distance = args.max_distance;
+    options.max_matches = args.max_matches;
+    if (args.timeout_ms > 0) {
+        options.deadline = Deadline(chrono::milliseconds(args.timeout_ms));
+    }
 
-    for (auto& elem : result) {
-        for (auto& piter : elem.second) {
-            if (args.colors) {
-                out << "\33[1m" << piter.name() << "\033[0m";
-            } else {
-                out << piter.name();
-            }
-            out << format(translate(" (%s-%s) from %s")) % piter.version() %
-                       piter.release() % elem.first
-                << endl;
-            if (args.colors) {
-                out << piter.hl_str(args.search_string, "\t", "\033[0;31m")
-                    << endl;
-            } else {
-                out << piter.hl_str(args.search_string, "\t", "") << endl;
-            }
+    if (!args.contains.empty()) {
+        options.contains = true;
+        vector<string> matches;
+        ResultMap result;
+        const bool complete = lookup(args.contains, args.database_path,
+                                     result, &matches, options);
+        if (result.empty()) {
+            return not_found(args.contains, "contains", !complete);
         }
+
+        print_result(heading(translate("Commands containing '%s' are "
+                                       "provided by the following packages:"),
+                             args.contains),
+                     args.contains, "contains", result, matches, !complete);
+        return finish(0);
     }
 
-    if (!result.empty()) {
-        cout
-            << format(translate(
-                   "The command '%s' is provided by the following packages:")) %
-                   args.search_string
-            << endl;
-        cout << out.str();
-        return 0;
-
-    }
-        std::shared_ptr<vector<string>> matches(new vector<string>());
-        ResultMap inexactResult;
-        lookup(args.search_string, args.database_path, inexactResult,
-               matches.get());
-
-        for (auto& elem : inexactResult) {
-            for (auto& piter : elem.second) {
-                if (args.colors) {
-                    out << "\033[1m" << piter.name() << "\033[0m";
-                } else {
-                    out << piter.name();
-                }
-                out << format(translate(" (%s-%s) from %s")) % piter.version() %
-                           piter.release() % elem.first
-                    << endl;
-                if (args.colors) {
-                    out << piter.hl_str(matches.get(), "\t", "\033[0;31m")
-                        << endl;
-                } else {
-                    out << piter.hl_str(matches.get(), "\t", "") << endl;
-                }
-            }
-        }
-        if (!inexactResult.empty()) {
-            cout << format(translate("A similar command to '%s' is provided by "
-                                     "the following packages:")) %
-                        args.search_string
+    if (!args.path.empty()) {
+        if (!command_from_path(args.path, args.search_string)) {
+            init_locale();
+            cerr << format(translate("'%s' is not a command path")) % args.path
                  << endl;
-            cout << out.str();
-            return 0;
+            return finish(1);
         }
+    } else {
+        args.search_string = argv[optind];
+    }
+
+    ResultMap result;
+
+    // exact matches first, the similar commands only get the time left over
+    bool complete = lookup(args.search_string, args.database_path, result,
+                           nullptr, options);
+
+    if (!result.empty()) {
+        const vector<string> highlights(1, args.search_string);
+        if (!args.path.empty()) {
+            print_result(heading(translate("The file '%s' is provided by the "
+                                           "following packages:"),
+                                 args.path),
+                         args.path, "path", result, highlights, !complete);
+        } else {
+            print_result(heading(translate("The command '%s' is provided by "
+                                           "the following packages:"),
+                                 args.search_string),
+                         args.search_string, "command", result, highlights,
+                         !complete);
+        }
+        return finish(0);
+    }
+
+    if (!complete || !args.path.empty()) {
+        return not_found(args.path.empty() ? args.search_string : args.path,
+                         args.path.empty() ? "command" : "path", !complete);
+    }
+
+    vector<string> matches;
+    ResultMap inexactResult;
+    complete = lookup(args.search_string, args.database_path, inexactResult,
+                      &matches, options);
+
+    if (!inexactResult.empty()) {
+        print_result(heading(translate("A similar command to '%s' is provided "
+                                       "by the following packages:"),
+                             args.search_string),
+                     args.search_string, "similar", inexactResult, matches,
+                     !complete);
+        return finish(0);
+    }
 
-    return 1;
+    return not_found(args.search_string, "similar", !complete);
 }
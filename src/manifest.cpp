@@ -0,0 +1,242 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "custom_exceptions.h"
+#include "hash.h"
+#include "manifest.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+const char* const Manifest::FILE_NAME = "catalogs.manifest";
+
+namespace {
+
+const string MAGIC = "cnf-manifest";
+const int FORMAT_VERSION = 2;
+const string CATALOG_EXTENSION = ".tdb";
+
+// nanosecond resolution, catalogs are often replaced within the same second
+bool modification_time(const string& path, string& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    mtime = to_string(st.st_mtim.tv_sec) + "." + to_string(st.st_mtim.tv_nsec);
+    return true;
+}
+
+bool parse(const string& database_path,
+           const bool check_mtime,
+           vector<CatalogInfo>& result) {
+    ifstream in((bf::path(database_path) / Manifest::FILE_NAME).c_str());
+    if (!in) {
+        return false;
+    }
+
+    string line;
+    if (!getline(in, line)) {
+        return false;
+    }
+
+    istringstream header(line);
+    string magic, recorded_mtime;
+    int version = 0;
+    header >> magic >> version >> recorded_mtime;
+    if (magic != MAGIC || version != FORMAT_VERSION) {
+        return false;
+    }
+
+    if (check_mtime) {
+        string mtime;
+        if (!modification_time(database_path, mtime) ||
+            mtime != recorded_mtime) {
+            return false;
+        }
+    }
+
+    while (getline(in, line)) {
+        istringstream entry(line);
+        CatalogInfo info;
+        string checksum;
+        entry >> info.name >> info.size;
+        if (info.name == "end") {
+            // a concurrent writer may have truncated the file under us
+            return entry && info.size == result.size();
+        }
+        entry >> info.generation >> checksum >> info.mtime;
+        if (!entry || !hash_from_string(checksum, info.checksum)) {
+            return false;
+        }
+        result.push_back(info);
+    }
+    return false;
+}
+
+CatalogInfo describe(const bf::path& file,
+                     const string& name,
+                     const vector<CatalogInfo>& previous) {
+    CatalogInfo info;
+    info.name = name;
+    // before hashing, a change while the file is read shows next time
+    modification_time(file.string(), info.mtime);
+    info.size = bf::file_size(file);
+    info.checksum = hash_file(file.string());
+    info.generation = 1;
+
+    const auto prev = find_if(
+        previous.begin(), previous.end(),
+        [&name](const CatalogInfo& other) { return other.name == name; });
+    if (prev != previous.end()) {
+        info.generation = prev->generation;
+        if (prev->size != info.size || prev->checksum != info.checksum) {
+            ++info.generation;
+        }
+    }
+    return info;
+}
+
+void refresh(const string& database_path,
+             const string* only,
+             vector<CatalogInfo>& result) {
+    vector<CatalogInfo> previous;
+    if (!parse(database_path, false, previous)) {
+        previous.clear();
+        only = nullptr;
+    }
+
+    using dirIter = bf::directory_iterator;
+    for (dirIter iter = dirIter(database_path); iter != dirIter(); ++iter) {
+        const bf::path cand(*iter);
+        if (cand.extension() != CATALOG_EXTENSION ||
+            !bf::is_regular_file(cand)) {
+            continue;
+        }
+        const string name = cand.stem().string();
+
+        const auto prev = find_if(
+            previous.begin(), previous.end(),
+            [&name](const CatalogInfo& other) { return other.name == name; });
+
+        try {
+            // catalogs may have been replaced without updating the manifest
+            string mtime;
+            if (only != nullptr && *only != name && prev != previous.end() &&
+                modification_time(cand.string(), mtime) &&
+                mtime == prev->mtime && bf::file_size(cand) == prev->size) {
+                result.push_back(*prev);
+            } else {
+                result.push_back(describe(cand, name, previous));
+            }
+        } catch (const InvalidArgumentException& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    sort(result.begin(), result.end(),
+         [](const CatalogInfo& lhs, const CatalogInfo& rhs) {
+             return lhs.name < rhs.name;
+         });
+}
+
+}  // namespace
+
+bool Manifest::read(const string& database_path) {
+    m_catalogs.clear();
+    if (!parse(database_path, true, m_catalogs)) {
+        m_catalogs.clear();
+        return false;
+    }
+    return true;
+}
+
+void Manifest::rebuild(const string& database_path) {
+    Manifest manifest;
+    refresh(database_path, nullptr, manifest.m_catalogs);
+    manifest.write(database_path);
+}
+
+void Manifest::update(const string& database_path, const string& catalog) {
+    Manifest manifest;
+    refresh(database_path, &catalog, manifest.m_catalogs);
+    manifest.write(database_path);
+}
+
+void Manifest::update(const string& database_path) {
+    // no catalog is rehashed unless its mtime or size changed
+    const string none;
+    update(database_path, none);
+}
+
+uint64_t Manifest::stamp() const {
+    Hasher hasher;
+    for (const auto& catalog : m_catalogs) {
+        hasher.update(catalog.name.data(), catalog.name.size() + 1);
+        hasher.update(&catalog.generation, sizeof(catalog.generation));
+        hasher.update(&catalog.checksum, sizeof(catalog.checksum));
+    }
+    return hasher.digest();
+}
+
+void Manifest::write(const string& database_path) const {
+    const bf::path file = bf::path(database_path) / FILE_NAME;
+
+    // Creating the file changes the directory mtime, so do that before the
+    // mtime is recorded. Rewriting it in place later does not.
+    if (!bf::exists(file)) {
+        ofstream create(file.c_str());
+    }
+
+    string mtime;
+    ofstream out;
+    if (modification_time(database_path, mtime)) {
+        out.open(file.c_str(), ios::trunc | ios::out);
+    }
+    if (!out) {
+        cerr << format(translate("Could not write catalog manifest: %s")) %
+                    file.string()
+             << endl;
+        return;
+    }
+
+    out << MAGIC << " " << FORMAT_VERSION << " " << mtime << "\n";
+    for (const auto& catalog : m_catalogs) {
+        out << catalog.name << " " << catalog.size << " " << catalog.generation
+            << " " << hash_to_string(catalog.checksum) << " "
+            << catalog.mtime << "\n";
+    }
+    out << "end " << m_catalogs.size() << "\n";
+}
+
+}  // namespace cnf
@@ -0,0 +1,75 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MANIFEST_H_
+#define MANIFEST_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnf {
+
+struct CatalogInfo {
+    std::string name;
+    uint64_t size;
+    uint64_t generation;
+    uint64_t checksum;
+    // of the file when it was hashed, entries are only reused while it and
+    // the size are unchanged
+    std::string mtime;
+};
+
+// The manifest lists the catalogs of a database directory so lookups do not
+// have to scan it. It records the modification time of the directory it was
+// written for; if the directory changed since (catalogs added, removed or
+// replaced) the manifest is considered stale and readers fall back to
+// scanning.
+class Manifest {
+public:
+    static const char* const FILE_NAME;
+
+    // Returns false if the manifest is missing, incomplete or stale.
+    bool read(const std::string& database_path);
+
+    // Rescan the directory and rewrite the manifest. Generations of
+    // catalogs whose size or checksum did not change are kept.
+    static void rebuild(const std::string& database_path);
+
+    // Refresh the entry for a single catalog after it has been written.
+    static void update(const std::string& database_path,
+                       const std::string& catalog);
+    // Refresh the entries of the catalogs that changed since the manifest
+    // was written, and its record of the directory after other files in it
+    // were replaced.
+    static void update(const std::string& database_path);
+
+    const std::vector<CatalogInfo>& catalogs() const { return m_catalogs; }
+
+    // Changes whenever any catalog changes, usable as a cache key.
+    uint64_t stamp() const;
+
+private:
+    void write(const std::string& database_path) const;
+
+    std::vector<CatalogInfo> m_catalogs;
+};
+
+}  // namespace cnf
+
+#endif /* MANIFEST_H_ */
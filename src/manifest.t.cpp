@@ -0,0 +1,90 @@
+#include "manifest.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "checksums.h"
+#include "db.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+void write(const bf::path& file, const std::string& content) {
+    std::ofstream(file.string(), std::ios::trunc) << content;
+}
+
+const cnf::CatalogInfo& info(const cnf::Manifest& manifest,
+                             const std::string& name) {
+    for (const auto& catalog : manifest.catalogs()) {
+        if (catalog.name == name) {
+            return catalog;
+        }
+    }
+    FAIL("no catalog " << name);
+    return manifest.catalogs().front();
+}
+
+}  // namespace
+
+TEST_CASE("manifest::replaced_catalog") {
+    TempDir dir;
+    const std::string path = dir.path.string();
+    write(dir.path / "core-x86_64.tdb", "core");
+    write(dir.path / "extra-x86_64.tdb", "extra");
+    cnf::Manifest::rebuild(path);
+
+    cnf::Manifest before;
+    REQUIRE(before.read(path));
+
+    // same size, replaced behind the manifest's back
+    write(dir.path / "extra-x86_64.tdb", "EXTRA");
+    bf::last_write_time(dir.path / "extra-x86_64.tdb",
+                        bf::last_write_time(dir.path / "core-x86_64.tdb") +
+                            60);
+    cnf::Manifest::update(path, "core-x86_64");
+
+    cnf::Manifest after;
+    REQUIRE(after.read(path));
+    CHECK(info(after, "core-x86_64").generation ==
+          info(before, "core-x86_64").generation);
+    CHECK(info(after, "extra-x86_64").generation ==
+          info(before, "extra-x86_64").generation + 1);
+    CHECK(info(after, "extra-x86_64").checksum !=
+          info(before, "extra-x86_64").checksum);
+    CHECK(after.stamp() != before.stamp());
+}
+
+TEST_CASE("manifest::mirror_run") {
+    TempDir dir;
+    const bf::path packages = dir.path / "mirror" / "core" / "os" / "x86_64";
+    const bf::path database = dir.path / "db";
+    bf::create_directories(packages);
+    bf::create_directories(database);
+    for (const std::string name : {"a", "b"}) {
+        cnf::test::write_package(packages / (name + "-1.0-1-x86_64.pkg.tar.gz"),
+                                 {"usr/bin/" + name});
+    }
+
+    // the catalogs list and its checksums are written after the catalogs
+    cnf::populate_mirror(dir.path / "mirror", database.string(), true, 0);
+    CHECK(cnf::Manifest().read(database.string()));
+
+    bf::remove(packages / "b-1.0-1-x86_64.pkg.tar.gz");
+    cnf::collect_garbage_mirror(dir.path / "mirror", database.string(), 0);
+    CHECK(cnf::Manifest().read(database.string()));
+
+    std::vector<cnf::Checksum> sums;
+    REQUIRE(cnf::read_checksums(
+        cnf::checksums_path((database / "catalogs-x86_64-tdb").string()),
+        sums));
+    REQUIRE(sums.size() == 1);
+    CHECK(cnf::verify_checksum(database.string(), sums[0]) == cnf::VERIFY_OK);
+}
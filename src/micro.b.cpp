@@ -0,0 +1,180 @@
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/filesystem.hpp>
+
+#include "db_tdb.h"
+#include "package.h"
+#include "similar.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+// Fixtures are generated from fixed seeds into a temporary directory, so
+// runs on different machines measure the same inputs.
+
+namespace {
+
+const unsigned SEED = 42;
+
+class Fixtures {
+public:
+    static Fixtures& get() {
+        static Fixtures fixtures;
+        return fixtures;
+    }
+
+    ~Fixtures() {
+        m_catalog.reset();
+        bf::remove_all(m_dir);
+    }
+
+    // a package file with entries paths, half of them commands
+    const bf::path& tarball(const int entries) {
+        auto iter = m_tarballs.find(entries);
+        if (iter != m_tarballs.end()) {
+            return iter->second;
+        }
+        const bf::path path =
+            m_dir / ("bench" + std::to_string(entries) + "-1.0-1-x86_64.pkg.tar.gz");
+
+        std::vector<std::string> names;
+        for (int i = 0; i < entries; ++i) {
+            names.push_back(
+                (i % 2 == 0 ? "usr/bin/command" : "usr/share/doc/file") +
+                std::to_string(i));
+        }
+        cnf::test::write_package(path, names);
+
+        return m_tarballs[entries] = path;
+    }
+
+    // a catalog of 1000 packages providing 10 commands each
+    const cnf::Database& catalog() {
+        if (!m_catalog) {
+            std::mt19937 rng(SEED);
+            std::unique_ptr<cnf::TdbDatabase> db(
+                new cnf::TdbDatabase("bench-x86_64", false, m_dir.string()));
+            for (int i = 0; i < 1000; ++i) {
+                std::vector<std::string> files;
+                for (int j = 0; j < 10; ++j) {
+                    files.push_back("cmd" + std::to_string(rng() % 5000));
+                }
+                db->storePackage(cnf::Package("pkg" + std::to_string(i),
+                                              "1.0", "1", "x86_64", "xz",
+                                              files));
+            }
+            db->flush();
+            m_catalog = std::move(db);
+        }
+        return *m_catalog;
+    }
+
+private:
+    Fixtures()
+        : m_dir(bf::temp_directory_path() /
+                bf::unique_path("cnf-bench-%%%%-%%%%")) {
+        bf::create_directories(m_dir);
+    }
+
+    const bf::path m_dir;
+    std::map<int, bf::path> m_tarballs;
+    std::unique_ptr<cnf::Database> m_catalog;
+};
+
+std::string word(const size_t length) {
+    std::mt19937 rng(SEED);
+    std::string result;
+    for (size_t i = 0; i < length; ++i) {
+        result += static_cast<char>('a' + rng() % 26);
+    }
+    return result;
+}
+
+}  // namespace
+
+static void BM_similar_words(benchmark::State& state) {
+    const std::string input = word(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cnf::similar_words(input));
+    }
+}
+BENCHMARK(BM_similar_words)->Arg(1)->Arg(4)->Arg(8)->Arg(16)->Arg(32);
+
+static void BM_package_filename(benchmark::State& state) {
+    const bf::path& path = Fixtures::get().tarball(1);
+    for (auto _ : state) {
+        cnf::Package p(path, true);
+        benchmark::DoNotOptimize(p.name());
+    }
+}
+BENCHMARK(BM_package_filename);
+
+static void BM_update_files(benchmark::State& state) {
+    const bf::path& path = Fixtures::get().tarball(state.range(0));
+    for (auto _ : state) {
+        cnf::Package p(path, false);
+        benchmark::DoNotOptimize(p.files().size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_update_files)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_hl_str(benchmark::State& state) {
+    std::vector<std::string> files;
+    for (int i = 0; i < state.range(0); ++i) {
+        files.push_back("command" + std::to_string(i));
+    }
+    const cnf::Package p("bench", "1.0", "1", "x86_64", "xz", files);
+    const std::vector<std::string> highlights = {"command1", "command7",
+                                                 "missing"};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(p.hl_str(&highlights, "\t", "\033[0;31m"));
+    }
+}
+BENCHMARK(BM_hl_str)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_get_packages_hit(benchmark::State& state) {
+    const cnf::Database& db = Fixtures::get().catalog();
+    std::mt19937 rng(SEED);
+    std::vector<cnf::Package> result;
+    for (auto _ : state) {
+        // the catalog holds cmd0..cmd4999, almost all of them provided
+        result.clear();
+        db.getPackages("cmd" + std::to_string(rng() % 5000), result);
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(BM_get_packages_hit);
+
+static void BM_get_packages_miss(benchmark::State& state) {
+    const cnf::Database& db = Fixtures::get().catalog();
+    std::mt19937 rng(SEED);
+    std::vector<cnf::Package> result;
+    for (auto _ : state) {
+        result.clear();
+        db.getPackages("nothing" + std::to_string(rng() % 5000), result);
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(BM_get_packages_miss);
+
+static void BM_find_commands(benchmark::State& state) {
+    const cnf::Database& db = Fixtures::get().catalog();
+    std::mt19937 rng(SEED);
+    std::vector<std::string> result;
+    for (auto _ : state) {
+        // three digits are part of a dozen or so of the commands
+        result.clear();
+        db.findCommands(std::to_string(100 + rng() % 900), result);
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(BM_find_commands);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,583 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "checksums.h"
+#include "config.h"
+#include "custom_exceptions.h"
+#include "hash.h"
+#include "manifest.h"
+#include "mirror.h"
+
+#ifdef WITH_ZSTD
+#include "catalog_pack.h"
+#endif
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+const long CONNECT_TIMEOUT = 30;
+// abort transfers slower than LOW_SPEED bytes/s for LOW_SPEED_TIME seconds
+const long LOW_SPEED = 1024;
+const long LOW_SPEED_TIME = 60;
+
+class CurlGlobal {
+public:
+    CurlGlobal() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+    ~CurlGlobal() { curl_global_cleanup(); }
+};
+
+string base_url(const string& mirror) {
+    string url = mirror;
+    if (url.find("://") == string::npos) {
+        url = "file://" + bf::absolute(url).string();
+    }
+    while (!url.empty() && url.back() == '/') {
+        url.pop_back();
+    }
+    return url + "/cnf/";
+}
+
+size_t write_string(char* data, size_t size, size_t count, void* out) {
+    static_cast<string*>(out)->append(data, size * count);
+    return size * count;
+}
+
+size_t write_file(char* data, size_t size, size_t count, void* out) {
+    return fwrite(data, size, count, static_cast<FILE*>(out)) * size;
+}
+
+void set_common_options(CURL* handle, const string& url) {
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, CONNECT_TIMEOUT);
+    curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, LOW_SPEED);
+    curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, LOW_SPEED_TIME);
+}
+
+bool fetch_text(const string& url,
+                const unsigned retries,
+                string& result,
+                uint64_t& bytes) {
+    CURLcode rc = CURLE_OK;
+    for (unsigned attempt = 0; attempt <= retries; ++attempt) {
+        result.clear();
+        CURL* handle = curl_easy_init();
+        set_common_options(handle, url);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_string);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &result);
+        rc = curl_easy_perform(handle);
+        curl_easy_cleanup(handle);
+        bytes += result.size();
+        if (rc == CURLE_OK) {
+            return true;
+        }
+        // a missing file will not appear on a retry
+        if (rc == CURLE_HTTP_RETURNED_ERROR || rc == CURLE_FILE_COULDNT_READ_FILE) {
+            break;
+        }
+    }
+    return false;
+}
+
+struct Transfer {
+    string name;
+    bf::path target;
+    bf::path temp;
+    unsigned attempts = 0;
+    FILE* out = nullptr;
+    CURL* handle = nullptr;
+    // false if the installed catalog lacks sections, it is fetched even if
+    // it is as new as the published one
+    bool conditional = true;
+#ifdef WITH_ZSTD
+    // set if the catalog is installed from its pack
+    shared_ptr<PackHeader> pack;
+    unsigned sections = PACK_ALL;
+    long filetime = -1;
+    // created with the first bytes, see write_pack()
+    unique_ptr<PackInstaller> installer;
+#endif
+};
+
+#ifdef WITH_ZSTD
+// bytes fetched first for the header of a pack: its dictionary of up to
+// 32 KiB and the frame table
+const size_t PACK_HEADER_PROBE = 40 << 10;
+
+string byte_range(const uint64_t first, const uint64_t last) {
+    return (format("%d-%d") % first % last).str();
+}
+
+// Fetch the header of a pack. Returns false if there is none (or it is
+// unreadable); unmet is set if target is as new as the pack and
+// conditional.
+bool fetch_pack_header(const string& url,
+                       const bf::path& target,
+                       const bool conditional,
+                       const unsigned retries,
+                       PackHeader& header,
+                       bool& unmet,
+                       long& filetime,
+                       uint64_t& bytes) {
+    boost::system::error_code ec;
+    const time_t mtime = bf::last_write_time(target, ec);
+    const bool check = conditional && !ec;
+
+    uint64_t probe = PACK_HEADER_PROBE;
+    for (unsigned attempt = 0; attempt <= retries; ++attempt) {
+        string data;
+        CURL* handle = curl_easy_init();
+        set_common_options(handle, url);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_string);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &data);
+        curl_easy_setopt(handle, CURLOPT_FILETIME, 1L);
+        const string range = byte_range(0, probe - 1);
+        curl_easy_setopt(handle, CURLOPT_RANGE, range.c_str());
+        if (check) {
+            curl_easy_setopt(handle, CURLOPT_TIMECONDITION,
+                             static_cast<long>(CURL_TIMECOND_IFMODSINCE));
+            curl_easy_setopt(handle, CURLOPT_TIMEVALUE,
+                             static_cast<long>(mtime));
+        }
+        const CURLcode rc = curl_easy_perform(handle);
+        long condition_unmet = 0;
+        curl_easy_getinfo(handle, CURLINFO_CONDITION_UNMET, &condition_unmet);
+        curl_easy_getinfo(handle, CURLINFO_FILETIME, &filetime);
+        curl_easy_cleanup(handle);
+        bytes += data.size();
+
+        if (rc == CURLE_HTTP_RETURNED_ERROR ||
+            rc == CURLE_FILE_COULDNT_READ_FILE) {
+            return false;
+        }
+        if (rc != CURLE_OK) {
+            continue;
+        }
+        // not every protocol checks the condition along with a range
+        unmet = condition_unmet != 0 ||
+                (check && filetime >= 0 && filetime <= mtime);
+        if (unmet) {
+            return true;
+        }
+        const size_t size = header.parse(data);
+        if (size == 0) {
+            return false;
+        }
+        if (size <= data.size()) {
+            return true;
+        }
+        // a larger dictionary than usual, the next attempt fetches it all
+        probe = size;
+    }
+    return false;
+}
+
+// The write callback of pack transfers: the bytes go to the installer
+// instead of a file.
+size_t write_pack(char* data, size_t size, size_t count, void* out) {
+    Transfer& transfer = *static_cast<Transfer*>(out);
+    if (!transfer.installer) {
+        // a server ignoring the range sends the whole pack
+        long code = 0;
+        curl_easy_getinfo(transfer.handle, CURLINFO_RESPONSE_CODE, &code);
+        const uint64_t begin =
+            code == 200 ? 0 : transfer.pack->range(transfer.sections).first;
+        try {
+            transfer.installer.reset(new PackInstaller(
+                *transfer.pack, transfer.sections, begin, transfer.temp));
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+            return 0;
+        }
+    }
+    return transfer.installer->write(data, size * count) ? size * count : 0;
+}
+#endif
+
+class Downloader {
+public:
+    Downloader(const string& url,
+               const SyncOptions& options,
+               const vector<Checksum>& checksums,
+               SyncStats& stats)
+        : m_url(url)
+        , m_options(options)
+        , m_checksums(checksums)
+        , m_stats(stats)
+        , m_multi(curl_multi_init())
+        , m_active(0) {}
+    ~Downloader() { curl_multi_cleanup(m_multi); }
+    Downloader(const Downloader&) = delete;
+    Downloader& operator=(const Downloader&) = delete;
+
+    void run(vector<Transfer>& transfers) {
+        for (auto& transfer : transfers) {
+            m_pending.push_back(&transfer);
+        }
+
+        while (!m_pending.empty() || m_active > 0) {
+            while (!m_pending.empty() && m_active < m_options.connections) {
+                Transfer* transfer = m_pending.front();
+                m_pending.pop_front();
+                start(*transfer);
+            }
+
+            int running = 0;
+            curl_multi_perform(m_multi, &running);
+
+            int queued = 0;
+            while (CURLMsg* msg = curl_multi_info_read(m_multi, &queued)) {
+                if (msg->msg != CURLMSG_DONE) {
+                    continue;
+                }
+                Transfer* transfer = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
+                                  &transfer);
+                finish(*transfer, msg->data.result);
+            }
+
+            if (m_active > 0) {
+                curl_multi_wait(m_multi, nullptr, 0, 1000, nullptr);
+            }
+        }
+    }
+
+private:
+    void start(Transfer& transfer) {
+        ++transfer.attempts;
+#ifdef WITH_ZSTD
+        if (transfer.pack) {
+            startPack(transfer);
+            return;
+        }
+#endif
+        transfer.out = fopen(transfer.temp.c_str(), "wb");
+        if (transfer.out == nullptr) {
+            cerr << format(translate("could not write: %s")) %
+                        transfer.temp.string()
+                 << endl;
+            ++m_stats.failed;
+            return;
+        }
+
+        transfer.handle = curl_easy_init();
+        set_common_options(transfer.handle, m_url + transfer.name);
+        curl_easy_setopt(transfer.handle, CURLOPT_WRITEFUNCTION, write_file);
+        curl_easy_setopt(transfer.handle, CURLOPT_WRITEDATA, transfer.out);
+        curl_easy_setopt(transfer.handle, CURLOPT_PRIVATE, &transfer);
+        curl_easy_setopt(transfer.handle, CURLOPT_FILETIME, 1L);
+
+        boost::system::error_code ec;
+        const time_t mtime = bf::last_write_time(transfer.target, ec);
+        if (!ec && transfer.conditional) {
+            curl_easy_setopt(transfer.handle, CURLOPT_TIMECONDITION,
+                             static_cast<long>(CURL_TIMECOND_IFMODSINCE));
+            curl_easy_setopt(transfer.handle, CURLOPT_TIMEVALUE,
+                             static_cast<long>(mtime));
+        }
+
+        curl_multi_add_handle(m_multi, transfer.handle);
+        ++m_active;
+    }
+
+#ifdef WITH_ZSTD
+    // the header is known already, only the frames of the wanted sections
+    // are fetched
+    void startPack(Transfer& transfer) {
+        const auto range = transfer.pack->range(transfer.sections);
+        const string bytes = byte_range(range.first, range.second - 1);
+
+        transfer.handle = curl_easy_init();
+        set_common_options(transfer.handle, m_url + transfer.name + ".zst");
+        curl_easy_setopt(transfer.handle, CURLOPT_RANGE, bytes.c_str());
+        curl_easy_setopt(transfer.handle, CURLOPT_WRITEFUNCTION, write_pack);
+        curl_easy_setopt(transfer.handle, CURLOPT_WRITEDATA, &transfer);
+        curl_easy_setopt(transfer.handle, CURLOPT_PRIVATE, &transfer);
+
+        curl_multi_add_handle(m_multi, transfer.handle);
+        ++m_active;
+    }
+
+    void finishPack(Transfer& transfer, const CURLcode result) {
+        curl_off_t size = 0;
+        curl_easy_getinfo(transfer.handle, CURLINFO_SIZE_DOWNLOAD_T, &size);
+        m_stats.bytes += static_cast<uint64_t>(size);
+        curl_multi_remove_handle(m_multi, transfer.handle);
+        curl_easy_cleanup(transfer.handle);
+        transfer.handle = nullptr;
+        --m_active;
+
+        string error;
+        if (result != CURLE_OK) {
+            error = curl_easy_strerror(result);
+        } else if (!transfer.installer || !transfer.installer->complete()) {
+            error = translate("corrupt catalog pack");
+        } else {
+            try {
+                transfer.installer->commit(transfer.target);
+                boost::system::error_code ec;
+                // a catalog lacking sections is not as new as the pack, the
+                // next sync that wants them has to fetch it
+                if (transfer.filetime >= 0 && transfer.sections == PACK_ALL) {
+                    bf::last_write_time(transfer.target, transfer.filetime,
+                                        ec);
+                }
+            } catch (const DatabaseException& e) {
+                error = e.what();
+            }
+        }
+        // removes the temporary file if it was not committed
+        transfer.installer.reset();
+
+        if (error.empty()) {
+            ++m_stats.updated;
+            if (m_options.verbosity > 0) {
+                cout << format(translate("%s updated")) % transfer.name << endl;
+            }
+            return;
+        }
+        if (transfer.attempts <= m_options.retries) {
+            m_pending.push_back(&transfer);
+            return;
+        }
+        ++m_stats.failed;
+        cerr << format(translate("Failed to download catalog %s: %s")) %
+                    transfer.name % error
+             << endl;
+    }
+#endif
+
+    void finish(Transfer& transfer, const CURLcode result) {
+#ifdef WITH_ZSTD
+        if (transfer.pack) {
+            finishPack(transfer, result);
+            return;
+        }
+#endif
+        long unmet = 0;
+        long filetime = -1;
+        curl_off_t size = 0;
+        curl_easy_getinfo(transfer.handle, CURLINFO_CONDITION_UNMET, &unmet);
+        curl_easy_getinfo(transfer.handle, CURLINFO_FILETIME, &filetime);
+        curl_easy_getinfo(transfer.handle, CURLINFO_SIZE_DOWNLOAD_T, &size);
+        m_stats.bytes += static_cast<uint64_t>(size);
+
+        curl_multi_remove_handle(m_multi, transfer.handle);
+        curl_easy_cleanup(transfer.handle);
+        transfer.handle = nullptr;
+        const bool written = fclose(transfer.out) == 0;
+        transfer.out = nullptr;
+        --m_active;
+
+        boost::system::error_code ec;
+        string error;
+        if (result != CURLE_OK) {
+            error = curl_easy_strerror(result);
+        } else if (!written) {
+            error = translate("could not write the temporary file");
+        } else if (unmet != 0) {
+            bf::remove(transfer.temp, ec);
+            ++m_stats.unchanged;
+            if (m_options.verbosity > 0) {
+                cout << format(translate("%s is up to date")) % transfer.name
+                     << endl;
+            }
+            return;
+        } else if (!verify(transfer)) {
+            error = translate("checksum mismatch");
+        }
+
+        if (error.empty()) {
+            if (filetime >= 0) {
+                bf::last_write_time(transfer.temp, filetime, ec);
+            }
+            bf::rename(transfer.temp, transfer.target, ec);
+            if (ec) {
+                error = ec.message();
+            }
+        }
+
+        if (error.empty()) {
+            ++m_stats.updated;
+            if (m_options.verbosity > 0) {
+                cout << format(translate("%s updated")) % transfer.name << endl;
+            }
+            return;
+        }
+
+        bf::remove(transfer.temp, ec);
+        if (transfer.attempts <= m_options.retries) {
+            m_pending.push_back(&transfer);
+            return;
+        }
+        ++m_stats.failed;
+        cerr << format(translate("Failed to download catalog %s: %s")) %
+                    transfer.name % error
+             << endl;
+    }
+
+    bool verify(const Transfer& transfer) const {
+        for (const auto& checksum : m_checksums) {
+            if (checksum.file == transfer.name) {
+                try {
+                    return hash_file(transfer.temp.string()) == checksum.hash;
+                } catch (const InvalidArgumentException&) {
+                    return false;
+                }
+            }
+        }
+        // an unlisted catalog can not be checked
+        return true;
+    }
+
+    const string m_url;
+    const SyncOptions& m_options;
+    const vector<Checksum>& m_checksums;
+    SyncStats& m_stats;
+    CURLM* const m_multi;
+    size_t m_active;
+    deque<Transfer*> m_pending;
+};
+
+}  // namespace
+
+bool sync_catalogs(const string& database_path,
+                   const SyncOptions& options,
+                   SyncStats& stats) {
+    const CurlGlobal curl;
+    const string url = base_url(options.mirror);
+    const string list_name = "catalogs-" + options.architecture + "-tdb";
+
+    string list;
+    if (!fetch_text(url + list_name, options.retries, list, stats.bytes)) {
+        return false;
+    }
+
+    bf::create_directories(database_path);
+
+    // the checksums are optional, older mirrors do not publish them
+    const string sums_name = checksums_path(list_name);
+    const bf::path sums_temp = bf::path(database_path) / ("." + sums_name);
+    vector<Checksum> checksums;
+    string sums;
+    bool have_sums = false;
+    if (fetch_text(url + sums_name, options.retries, sums, stats.bytes)) {
+        FILE* out = fopen(sums_temp.c_str(), "wb");
+        have_sums = out != nullptr &&
+                    fwrite(sums.data(), 1, sums.size(), out) == sums.size();
+        have_sums = out != nullptr && fclose(out) == 0 && have_sums;
+        have_sums = have_sums && read_checksums(sums_temp.string(), checksums);
+        if (!have_sums) {
+            cerr << format(translate("Ignoring unreadable checksums %s")) %
+                        sums_name
+                 << endl;
+            checksums.clear();
+        }
+    }
+
+    vector<Transfer> transfers;
+    bool packed = false;
+    istringstream names(list);
+    string name;
+    while (names >> name) {
+        // the list comes from the network, only accept plain file names
+        if (name.find('/') != string::npos || name[0] == '.') {
+            continue;
+        }
+        Transfer transfer;
+        transfer.name = name;
+        transfer.target = bf::path(database_path) / name;
+        transfer.temp = bf::path(database_path) / ("." + name + ".part");
+#ifdef WITH_ZSTD
+        // the sections wanted from a pack, a plain catalog holds all
+        const unsigned wanted =
+            options.packs && !options.file_lists
+                ? static_cast<unsigned>(PACK_COMMANDS)
+                : static_cast<unsigned>(PACK_ALL);
+        transfer.conditional =
+            (wanted & ~installed_sections(transfer.target)) == 0;
+        if (options.packs) {
+            auto header = make_shared<PackHeader>();
+            bool unmet = false;
+            if (fetch_pack_header(url + name + ".zst", transfer.target,
+                                  transfer.conditional, options.retries,
+                                  *header, unmet, transfer.filetime,
+                                  stats.bytes)) {
+                packed = true;
+                if (unmet) {
+                    ++stats.unchanged;
+                    if (options.verbosity > 0) {
+                        cout << format(translate("%s is up to date")) % name
+                             << endl;
+                    }
+                    continue;
+                }
+                transfer.sections = wanted;
+                const auto range = header->range(transfer.sections);
+                // nothing to fetch of an empty catalog
+                if (range.first != range.second) {
+                    transfer.pack = header;
+                }
+            }
+        }
+#endif
+        transfers.push_back(move(transfer));
+    }
+
+    Downloader downloader(url, options, checksums, stats);
+    downloader.run(transfers);
+
+    // the local list describes the installed catalogs, which are partly
+    // outdated if a download failed
+    boost::system::error_code ec;
+    if (!packed && have_sums && stats.failed == 0) {
+        bf::rename(sums_temp, bf::path(database_path) / sums_name, ec);
+    } else {
+        // catalogs installed from packs are written anew and do not match
+        // the published checksums; after a failed download, the checksums
+        // of the previous sync describe catalogs replaced since
+        bf::remove(sums_temp, ec);
+        bf::remove(bf::path(database_path) / sums_name, ec);
+    }
+
+    Manifest::rebuild(database_path);
+    return true;
+}
+
+}  // namespace cnf
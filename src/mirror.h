@@ -0,0 +1,65 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIRROR_H_
+#define MIRROR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cnf {
+
+struct SyncOptions {
+    // http(s):// or file:// URL, or a local directory, containing cnf/
+    std::string mirror;
+    std::string architecture;
+    // concurrent transfers
+    unsigned connections = 4;
+    // additional attempts per file
+    unsigned retries = 2;
+    uint8_t verbosity = 0;
+    // install catalogs from their packs (<catalog>.zst, see catalog_pack.h)
+    // where the mirror publishes them; only built WITH_ZSTD
+    bool packs = true;
+    // without, only the part of the packs a lookup needs is fetched and the
+    // results show no file lists
+    bool file_lists = true;
+};
+
+struct SyncStats {
+    size_t updated = 0;
+    size_t unchanged = 0;
+    size_t failed = 0;
+    uint64_t bytes = 0;
+};
+
+// Download the catalogs of the mirror's catalog list that changed since the
+// local copy. Each catalog is written to a temporary file, checked against
+// the published checksums (if any) and renamed over the old one, so
+// readers see either the old or the new catalog. Catalogs installed from
+// packs are checked by the checksums of their frames instead. The manifest
+// is rebuilt afterwards. Returns false if the catalog list could not be
+// fetched.
+bool sync_catalogs(const std::string& database_path,
+                   const SyncOptions& options,
+                   SyncStats& stats);
+
+}  // namespace cnf
+
+#endif /* MIRROR_H_ */
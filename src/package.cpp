@@ -18,10 +18,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <iostream>
 #include <regex>
-#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <archive.h>
@@ -29,7 +30,9 @@
 #include <boost/format.hpp>
 #include <boost/locale.hpp>
 
+#include "file_list_cache.h"
 #include "package.h"
+#include "trace.h"
 
 namespace bf = boost::filesystem;
 using namespace std;
@@ -38,8 +41,130 @@ using boost::locale::translate;
 
 namespace cnf {
 
-Package::Package(const bf::path& path, const bool lazy)
-    : m_filesDetermined(false), m_path(new bf::path(path)) {
+namespace {
+
+// libarchive reads in blocks of this size; larger reads mean fewer system
+// calls and let the read ahead of network file systems work
+const size_t READ_BLOCK_SIZE = 1 << 16;
+
+bool is_alpha(const char c) {
+    return isalpha(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_digit(const char c) {
+    return isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_alnum(const char c) {
+    return isalnum(static_cast<unsigned char>(c)) != 0;
+}
+
+// rpmvercmp() of libalpm: the strings are compared by runs of digits and
+// letters, separators only count by their length
+int compare_segments(const string& a, const string& b) {
+    if (a == b) {
+        return 0;
+    }
+
+    size_t one = 0;
+    size_t two = 0;
+    size_t ptr1 = 0;
+    size_t ptr2 = 0;
+    while (ptr1 < a.size() && ptr2 < b.size()) {
+        while (ptr1 < a.size() && !is_alnum(a[ptr1])) {
+            ++ptr1;
+        }
+        while (ptr2 < b.size() && !is_alnum(b[ptr2])) {
+            ++ptr2;
+        }
+        if (ptr1 == a.size() || ptr2 == b.size()) {
+            break;
+        }
+        if (ptr1 - one != ptr2 - two) {
+            return ptr1 - one < ptr2 - two ? -1 : 1;
+        }
+
+        one = ptr1;
+        two = ptr2;
+        const bool numeric = is_digit(a[ptr1]);
+        const auto same_kind = numeric ? is_digit : is_alpha;
+        while (ptr1 < a.size() && same_kind(a[ptr1])) {
+            ++ptr1;
+        }
+        while (ptr2 < b.size() && same_kind(b[ptr2])) {
+            ++ptr2;
+        }
+        // a number is newer than letters
+        if (two == ptr2) {
+            return numeric ? 1 : -1;
+        }
+
+        if (numeric) {
+            while (one < ptr1 && a[one] == '0') {
+                ++one;
+            }
+            while (two < ptr2 && b[two] == '0') {
+                ++two;
+            }
+            if (ptr1 - one != ptr2 - two) {
+                return ptr1 - one < ptr2 - two ? -1 : 1;
+            }
+        }
+        const int rc = a.compare(one, ptr1 - one, b, two, ptr2 - two);
+        if (rc != 0) {
+            return rc < 0 ? -1 : 1;
+        }
+        one = ptr1;
+        two = ptr2;
+    }
+
+    if (one == a.size() && two == b.size()) {
+        return 0;
+    }
+    // letters left over make a version older, e.g. 1.0rc1 is before 1.0
+    if ((one == a.size() && !is_alpha(b[two])) ||
+        (one < a.size() && is_alpha(a[one]))) {
+        return -1;
+    }
+    return 1;
+}
+
+struct Version {
+    string epoch;
+    string version;
+    string release;
+};
+
+// "[epoch:]version[-release]", without an epoch it is 0
+Version split_version(const string& full) {
+    Version result;
+    size_t start = 0;
+    while (start < full.size() && is_digit(full[start])) {
+        ++start;
+    }
+    if (start < full.size() && full[start] == ':') {
+        result.epoch = start > 0 ? full.substr(0, start) : "0";
+        ++start;
+    } else {
+        result.epoch = "0";
+        start = 0;
+    }
+    const size_t dash = full.rfind('-');
+    if (dash != string::npos && dash >= start) {
+        result.version = full.substr(start, dash - start);
+        result.release = full.substr(dash + 1);
+    } else {
+        result.version = full.substr(start);
+    }
+    return result;
+}
+
+}  // namespace
+
+Package::Package(const bf::path& path,
+                 const bool lazy,
+                 FileListCache* const file_lists)
+    : m_filesDetermined(false), m_path(path), m_fileLists(file_lists) {
     // checks
     if (!bf::is_regular_file(path)) {
         string message;
@@ -48,33 +173,39 @@ Package::Package(const bf::path& path, const bool lazy)
         throw InvalidArgumentException(MISSING_FILE, message);
     }
 
+    Package parsed = package_from_path(path);
+    m_name = move(parsed.m_name);
+    m_version = move(parsed.m_version);
+    m_release = move(parsed.m_release);
+    m_architecture = move(parsed.m_architecture);
+    m_compression = move(parsed.m_compression);
+
+    if (!lazy) {
+        updateFiles();
+    }
+}
+
+Package package_from_path(const bf::path& path) {
     static const regex valid_name(
         "(.+)-(.+)-(.+)-(any|i686|x86_64).pkg.tar.(xz|gz)");
 
     cmatch what;
 
-    const string& filename = path.filename().string();
+    const string filename = path.filename().string();
 
     try {
         if (regex_match(filename.c_str(), what, valid_name)) {
-            m_name = what[1];
-            m_version = what[2];
-            m_release = what[3];
-            m_architecture = what[4];
-            m_compression = what[5];
-        } else {
-            string message;
-            message += translate("this is not a valid package file: ");
-            message += path.string();
-            throw InvalidArgumentException(INVALID_FILE, message);
+            return Package(what[1], what[2], what[3], what[4], what[5],
+                           vector<string>());
         }
     } catch (const std::logic_error& e) {
         throw InvalidArgumentException(UNKNOWN_ERROR, e.what());
     }
 
-    if (!lazy) {
-        updateFiles();
-    }
+    string message;
+    message += translate("this is not a valid package file: ");
+    message += path.string();
+    throw InvalidArgumentException(INVALID_FILE, message);
 }
 
 const vector<string>& Package::files() const {
@@ -91,7 +222,12 @@ const vector<string>& Package::files() const {
 void Package::updateFiles() const {
     // read package file list
 
-    assert(m_path);
+    assert(!m_path.empty());
+
+    if (m_fileLists && m_fileLists->get(m_path, m_files)) {
+        m_filesDetermined = true;
+        return;
+    }
 
     struct archive* arc = nullptr;
     struct archive_entry* entry = nullptr;
@@ -102,12 +238,12 @@ void Package::updateFiles() const {
     archive_read_support_filter_all(arc);
     archive_read_support_format_tar(arc);
 
-    rc = archive_read_open_filename(arc, m_path->c_str(), 10240);
+    rc = archive_read_open_filename(arc, m_path.c_str(), READ_BLOCK_SIZE);
 
     if (rc != ARCHIVE_OK) {
         format message;
         message = format(translate("could not read file list from: %s")) %
-                  m_path->string();
+                  m_path.string();
         throw InvalidArgumentException(INVALID_FILE, message.str());
     }
     while (archive_read_next_header(arc, &entry) == ARCHIVE_OK) {
@@ -119,17 +255,15 @@ void Package::updateFiles() const {
     if (rc != ARCHIVE_OK) {
         format message;
         message = format(translate("error while closing archive: %s")) %
-                  m_path->string();
+                  m_path.string();
         throw InvalidArgumentException(INVALID_FILE, message.str());
     }
 
-    const regex significant("((usr/)?(s)?bin/([0-9A-Za-z.-]+))");
-
-    cmatch what;
     try {
+        string command;
         for (const auto& candidate : candidates) {
-            if (regex_match(candidate.c_str(), what, significant)) {
-                m_files.push_back(what[4]);
+            if (command_from_path(candidate, command)) {
+                m_files.push_back(command);
             }
         }
     } catch (const std::logic_error& e) {
@@ -137,6 +271,9 @@ void Package::updateFiles() const {
     }
 
     m_filesDetermined = true;
+    if (m_fileLists) {
+        m_fileLists->put(m_path, m_files);
+    }
 }
 
 const string Package::hl_str(const string& hl,
@@ -151,40 +288,77 @@ const string Package::hl_str(const string& hl,
 const string Package::hl_str(const vector<string>* hl,
                              const string& files_indent,
                              const string& color) const {
-    stringstream out;
-    out << files_indent << "[ ";
+    CNF_TRACE_SCOPE(PHASE_FORMAT);
 
-    int linelength = 0;
-    for (const auto& file : files()) {
-        bool highlight = false;
-        if (hl != nullptr) {
-            for (const auto& hlIter : *hl) {
-                if (!hlIter.empty() && hlIter == file) {
-                    highlight = true;
-                    break;
-                }
-            }
-        }
+    unordered_set<string> highlights;
+    if (hl != nullptr) {
+        highlights.insert(hl->begin(), hl->end());
+    }
 
+    string out;
+    hl_append(out, highlights, files_indent, color);
+    return out;
+}
+
+void Package::hl_append(string& out,
+                        const unordered_set<string>& hl,
+                        const string& files_indent,
+                        const string& color) const {
+    out += files_indent;
+    out += "[ ";
+
+    size_t linelength = 0;
+    for (const auto& file : files()) {
         if (linelength + file.size() > 80) {
             linelength = 0;
-            out << endl << files_indent << "  ";
+            out += '\n';
+            out += files_indent;
+            out += "  ";
         }
-
         linelength += file.size() + 1;
-        if (highlight) {
-            if (color.empty()) {
-                out << "*" << file << "* ";
-            } else {
-                out << color << file << "\033[0m"
-                    << " ";
-            }
+
+        if (file.empty() || hl.count(file) == 0) {
+            out += file;
+        } else if (color.empty()) {
+            out += '*';
+            out += file;
+            out += '*';
         } else {
-            out << file << " ";
+            out += color;
+            out += file;
+            out += "\033[0m";
         }
+        out += ' ';
+    }
+    out += ']';
+}
+
+bool command_from_path(const string& path, string& command) {
+    static const regex significant("/?((usr/)?(s)?bin/([0-9A-Za-z.-]+))");
+
+    cmatch what;
+    if (!regex_match(path.c_str(), what, significant)) {
+        return false;
+    }
+    command = what[4];
+    return true;
+}
+
+int compare_versions(const string& a, const string& b) {
+    if (a == b) {
+        return 0;
+    }
+    const Version lhs = split_version(a);
+    const Version rhs = split_version(b);
+    int result = compare_segments(lhs.epoch, rhs.epoch);
+    if (result == 0) {
+        result = compare_segments(lhs.version, rhs.version);
+    }
+    // a missing release matches any
+    if (result == 0 && !lhs.release.empty() && !rhs.release.empty()) {
+        result = compare_segments(lhs.release, rhs.release);
     }
-    out << "]";
-    return out.str();
+    return result;
 }
 
 ostream& operator<<(ostream& out, const Package& p) {
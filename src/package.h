@@ -20,6 +20,7 @@
 #define PARSEPKG_H_
 
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -29,9 +30,15 @@
 
 namespace cnf {
 
+class FileListCache;
+
 class Package {
 public:
-    explicit Package(const boost::filesystem::path& path, bool lazy = false);
+    // file_lists, if given, is asked for the commands before the package file
+    // is read and has to outlive the package
+    explicit Package(const boost::filesystem::path& path,
+                     bool lazy = false,
+                     FileListCache* file_lists = nullptr);
     explicit Package(std::string name,
                      std::string version,
                      std::string release,
@@ -45,9 +52,7 @@ public:
         , m_compression(std::move(compression))
         , m_files(std::move(files))
         , m_filesDetermined(true)
-        , m_path(nullptr) {}
-
-    ~Package() { delete m_path; }
+        , m_fileLists(nullptr) {}
 
     const std::vector<std::string>& files() const;
 
@@ -62,6 +67,11 @@ public:
     const std::string hl_str(const std::vector<std::string>* /*hl*/ = nullptr,
                              const std::string& files_indent = "",
                              const std::string& color = "") const;
+    // hl_str() appending to out, with the highlights already in a set
+    void hl_append(std::string& out,
+                   const std::unordered_set<std::string>& hl,
+                   const std::string& files_indent,
+                   const std::string& color) const;
 
 private:
     void updateFiles() const;
@@ -73,11 +83,26 @@ private:
     std::string m_compression;
     mutable std::vector<std::string> m_files;
     mutable bool m_filesDetermined;
-    boost::filesystem::path* m_path;
+    // only set for packages read from a file, see updateFiles()
+    boost::filesystem::path m_path;
+    FileListCache* m_fileLists;
 };
 
 enum PackageError { MISSING_FILE, INVALID_FILE, UNKNOWN_ERROR };
 
+// Extract the command name from a path within a package (e.g. usr/bin/ls or
+// /usr/bin/ls). Returns false for paths that are not indexed as commands.
+bool command_from_path(const std::string& path, std::string& command);
+
+// The package a file name like <name>-<version>-<release>-<arch>.pkg.tar.xz
+// stands for, without files and without reading the file, which may be gone
+// already. Throws InvalidArgumentException for other names.
+Package package_from_path(const boost::filesystem::path& path);
+
+// Compare two "[epoch:]version[-release]" strings like pacman's vercmp:
+// negative if a is older than b, 0 if they are equal, positive if newer.
+int compare_versions(const std::string& a, const std::string& b);
+
 std::ostream& operator<<(std::ostream& out, const Package& p);
 
 bool operator<(const Package& lhs, const Package& rhs);
@@ -16,9 +16,13 @@
     along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <getopt.h>
 #include <boost/filesystem.hpp>
@@ -27,6 +31,9 @@
 
 #include "config.h"
 #include "db.h"
+#include "file_list_cache.h"
+#include "manifest.h"
+#include "watch.h"
 
 namespace bf = boost::filesystem;
 using namespace cnf;
@@ -41,16 +48,34 @@ static struct args_t {
     int verbosity;
     bool mirror;
     bool truncate;
+    bool update_manifest;
+    long memory_limit_mb;
+    bool gc;
+    bool file_cache;
+    long readahead_mb;
+    bool watch;
+    long debounce_ms;
+    string contents;
+    bool compress;
 } args;
 
-static const char* OPT_STRING = "p:c:mtd:vh?";
+static const char* OPT_STRING = "p:f:c:mtuM:gNR:wD:Zd:vh?";
 
 static const struct option LONG_OPTS[] = {
     {"database-path", required_argument, nullptr, 'd'},
     {"catalog", required_argument, nullptr, 'c'},
     {"mirror", no_argument, nullptr, 'm'},
     {"truncate", no_argument, nullptr, 't'},
+    {"update-manifest", no_argument, nullptr, 'u'},
+    {"memory-limit", required_argument, nullptr, 'M'},
+    {"gc", no_argument, nullptr, 'g'},
+    {"no-file-cache", no_argument, nullptr, 'N'},
+    {"readahead", required_argument, nullptr, 'R'},
+    {"watch", no_argument, nullptr, 'w'},
+    {"debounce-ms", required_argument, nullptr, 'D'},
+    {"compress", no_argument, nullptr, 'Z'},
     {"package-path", required_argument, nullptr, 'p'},
+    {"from-contents", required_argument, nullptr, 'f'},
     {"verbose", no_argument, nullptr, 'v'},
     {"help", no_argument, nullptr, 'h'},
     {nullptr, no_argument, nullptr, 0}};
@@ -65,6 +90,15 @@ void usage() {
          << translate(
                 "   cnf-populate -p <path> ( -c <catalog> | -m ) [ -d <path> ] "
                 "        \n")
+         << translate(
+                "   cnf-populate -g -p <path> ( -c <catalog> | -m ) [ -d <path> "
+                "]    \n")
+         << translate(
+                "   cnf-populate -f <file|-> -c <catalog> [ -d <path> ]        "
+                "        \n")
+         << translate(
+                "   cnf-populate -u [ -d <path> ]                              "
+                "        \n")
          << translate(
                 "                                                              "
                 "        \n")
@@ -83,6 +117,11 @@ void usage() {
          << translate(
                 " --package-path    -p        Set the path containing the "
                 "packages     \n")
+         << translate(
+                " --from-contents   -f        Index the \"path<TAB>package "
+                "version-release\n"
+                "                             arch\" lines of a file (- for "
+                "stdin)     \n")
          << translate(
                 " --catalog         -c        Set the catalog name to index "
                 "(e.g. core)\n")
@@ -92,6 +131,48 @@ void usage() {
          << translate(
                 " --truncate        -t        Truncate the catalog before "
                 "indexing     \n")
+         << translate(
+                " --update-manifest -u        Rebuild the catalog manifest "
+                "(e.g. after  \n"
+                "                             downloading catalogs)            "
+                "        \n")
+         << translate(
+                " --memory-limit    -M        Sort the command index on disk, "
+                "using about\n"
+                "                             this many MiB of memory          "
+                "        \n")
+         << translate(
+                " --gc              -g        Remove packages no longer in the "
+                "package\n"
+                "                             path and compact the catalog     "
+                "        \n")
+         << translate(
+                " --no-file-cache   -N        Read every package, even if its "
+                "files are\n"
+                "                             cached from an earlier run       "
+                "        \n")
+         << translate(
+                " --readahead       -R        MiB of package files to prefetch "
+                "(default\n"
+                "                             64, 0 disables it)               "
+                "        \n")
+         << translate(
+                " --watch           -w        Keep updating the catalogs as "
+                "packages are\n"
+                "                             added to or removed from the "
+                "package path\n")
+         << translate(
+                " --debounce-ms     -D        Wait for this many milliseconds "
+                "without\n"
+                "                             changes before updating (default "
+                "2000)  \n")
+#ifdef WITH_ZSTD
+         << translate(
+                " --compress        -Z        Also publish the catalogs as "
+                "zstd packs\n"
+                "                             (<catalog>.tdb.zst) for cnf-sync "
+                "        \n")
+#endif
          << format(translate(" --database-path   -d        Customize the "
                              "database lookup path       \n"
                              "                             default is %s       "
@@ -113,6 +194,14 @@ int main(int argc, char** argv) {
     args.mirror = false;
     args.package_path = "";
     args.verbosity = 0;
+    args.update_manifest = false;
+    args.memory_limit_mb = 0;
+    args.gc = false;
+    args.file_cache = true;
+    args.readahead_mb = 64;
+    args.watch = false;
+    args.debounce_ms = 2000;
+    args.compress = false;
 
     int opt(0), long_index(0);
 
@@ -128,12 +217,52 @@ int main(int argc, char** argv) {
             case 'p':
                 args.package_path = optarg;
                 break;
+            case 'f':
+                args.contents = optarg;
+                break;
             case 'm':
                 args.mirror = true;
                 break;
             case 't':
                 args.truncate = true;
                 break;
+            case 'u':
+                args.update_manifest = true;
+                break;
+            case 'M':
+                args.memory_limit_mb = strtol(optarg, nullptr, 10);
+                if (args.memory_limit_mb <= 0) {
+                    usage();
+                }
+                break;
+            case 'g':
+                args.gc = true;
+                break;
+            case 'N':
+                args.file_cache = false;
+                break;
+            case 'w':
+                args.watch = true;
+                break;
+            case 'D':
+                args.debounce_ms = strtol(optarg, nullptr, 10);
+                if (args.debounce_ms < 0) {
+                    usage();
+                }
+                break;
+            case 'R':
+                args.readahead_mb = strtol(optarg, nullptr, 10);
+                if (args.readahead_mb < 0) {
+                    usage();
+                }
+                break;
+            case 'Z':
+#ifdef WITH_ZSTD
+                args.compress = true;
+#else
+                usage();
+#endif
+                break;
             case 'v':
                 args.verbosity++;
                 break;
@@ -151,6 +280,44 @@ int main(int argc, char** argv) {
         usage();
     }
 
+    if (args.update_manifest && args.package_path.empty()) {
+        if (!bf::is_directory(args.database_path)) {
+            cerr << format(translate("Not a valid database path: %s")) %
+                        args.database_path
+                 << endl;
+            return 1;
+        }
+        Manifest::rebuild(args.database_path);
+        return 0;
+    }
+
+    if (!args.contents.empty()) {
+        if (!args.package_path.empty() || args.catalog.empty() ||
+            args.mirror || args.gc || args.watch) {
+            usage();
+        }
+        PopulateOptions options;
+        options.memory_limit = static_cast<size_t>(args.memory_limit_mb) << 20;
+        options.compress = args.compress;
+        // the catalog would create it only later, the sort runs go there
+        boost::system::error_code ec;
+        bf::create_directories(args.database_path, ec);
+        if (args.contents == "-") {
+            populate_contents(cin, args.database_path, args.catalog,
+                              args.truncate, args.verbosity, options);
+            return 0;
+        }
+        ifstream in(args.contents);
+        if (!in) {
+            cerr << format(translate("Could not open %s")) % args.contents
+                 << endl;
+            return 1;
+        }
+        populate_contents(in, args.database_path, args.catalog, args.truncate,
+                          args.verbosity, options);
+        return 0;
+    }
+
     if (args.package_path.empty()) {
         usage();
     }
@@ -168,12 +335,78 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (args.gc) {
+        if (args.watch || (!args.mirror && args.catalog.empty())) {
+            usage();
+        }
+        PopulateOptions options;
+        options.compress = args.compress;
+        if (args.mirror) {
+            const uint64_t reclaimed =
+                collect_garbage_mirror(args.package_path, args.database_path,
+                                       args.verbosity, options);
+            cout << format(translate("Reclaimed %d bytes in total")) %
+                        reclaimed
+                 << endl;
+        } else {
+            collect_garbage(vector<bf::path>(1, args.package_path),
+                            args.database_path, args.catalog, args.verbosity,
+                            options);
+        }
+        return 0;
+    }
+
+    PopulateOptions options;
+    options.memory_limit = static_cast<size_t>(args.memory_limit_mb) << 20;
+    options.readahead = static_cast<uint64_t>(args.readahead_mb) << 20;
+    options.compress = args.compress;
+    if (args.file_cache) {
+        // the catalogs would create it only later
+        boost::system::error_code ec;
+        bf::create_directories(args.database_path, ec);
+        try {
+            options.file_lists = make_shared<FileListCache>(
+                FileListCache::default_path(args.database_path));
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    // watching starts first, nothing added during the initial run is missed
+    unique_ptr<CatalogWatcher> watcher;
+    if (args.watch) {
+        WatchOptions watch_options;
+        watch_options.debounce_ms = static_cast<unsigned>(args.debounce_ms);
+        watch_options.file_lists = options.file_lists;
+        watch_options.compress = options.compress;
+        try {
+            watcher.reset(new CatalogWatcher(args.database_path,
+                                             args.verbosity, watch_options));
+            if (args.mirror) {
+                for (const auto& catalog : mirror_layout(args.package_path)) {
+                    for (const auto& dir : catalog.second) {
+                        watcher->add(catalog.first, dir);
+                    }
+                }
+            } else {
+                watcher->add(args.catalog, args.package_path);
+            }
+        } catch (const DatabaseException& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
     if (args.mirror) {
         populate_mirror(args.package_path, args.database_path, args.truncate,
-                        args.verbosity);
+                        args.verbosity, options);
     } else {
         populate(args.package_path, args.database_path, args.catalog,
-                 args.truncate, args.verbosity);
+                 args.truncate, args.verbosity, options);
+    }
+
+    if (watcher) {
+        watcher->run();
     }
     return 0;
 }
@@ -0,0 +1,89 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstdint>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "prefetch.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+// returns the bytes requested
+uint64_t will_need(const bf::path& file) {
+    boost::system::error_code ec;
+    const uintmax_t size = bf::file_size(file, ec);
+    if (ec || size == 0) {
+        return 0;
+    }
+
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    // only a hint, the reads work without
+    const bool requested = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+    close(fd);
+    return requested ? size : 0;
+}
+
+}  // namespace
+
+Prefetcher::Prefetcher(const vector<bf::path>& files,
+                       const uint64_t window,
+                       Filter needed)
+    : m_files(files)
+    , m_window(window)
+    , m_needed(move(needed))
+    , m_sizes(files.size(), 0)
+    , m_done(0)
+    , m_next(0)
+    , m_ahead(0)
+    , m_requested(0) {}
+
+void Prefetcher::advance(const size_t index) {
+    for (; m_done < index && m_done < m_next; ++m_done) {
+        m_ahead -= m_sizes[m_done];
+    }
+    // the window may have been too small for the files in between
+    if (m_next < index) {
+        m_next = index;
+        m_done = index;
+    }
+
+    // the file about to be read counts as well, there is no point in
+    // requesting it only after the ones behind it
+    while (m_next < m_files.size() && m_ahead < m_window) {
+        if (!m_needed || m_needed(m_files[m_next])) {
+            m_sizes[m_next] = will_need(m_files[m_next]);
+            m_ahead += m_sizes[m_next];
+            m_requested += m_sizes[m_next];
+        }
+        ++m_next;
+    }
+}
+
+}  // namespace cnf
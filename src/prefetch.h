@@ -0,0 +1,66 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace cnf {
+
+// Asks the kernel to read the package files populate() works on next
+// (posix_fadvise(POSIX_FADV_WILLNEED)), so that their blocks arrive while the
+// current package is decompressed instead of one synchronous read after the
+// other. At most window bytes are requested ahead, files for which needed
+// returns false are skipped.
+class Prefetcher {
+public:
+    using Filter = std::function<bool(const boost::filesystem::path&)>;
+
+    Prefetcher(const std::vector<boost::filesystem::path>& files,
+               uint64_t window,
+               Filter needed);
+
+    // to be called before files[index] is read
+    void advance(size_t index);
+
+    // bytes requested so far
+    uint64_t requested() const { return m_requested; }
+
+private:
+    const std::vector<boost::filesystem::path>& m_files;
+    const uint64_t m_window;
+    const Filter m_needed;
+
+    // requested bytes per file, 0 for those skipped
+    std::vector<uint64_t> m_sizes;
+    size_t m_done;   // files before this one were read already
+    size_t m_next;   // the first file not considered yet
+    uint64_t m_ahead;  // requested bytes of the files in [m_done, m_next)
+    uint64_t m_requested;
+};
+
+}  // namespace cnf
+
+#endif /* PREFETCH_H_ */
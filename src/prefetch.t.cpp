@@ -0,0 +1,65 @@
+#include "prefetch.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+// ten files of 1000 bytes
+std::vector<bf::path> files(const bf::path& dir) {
+    std::vector<bf::path> result;
+    for (int i = 0; i < 10; ++i) {
+        result.push_back(dir / ("file" + std::to_string(i)));
+        std::ofstream(result.back().string()) << std::string(1000, 'x');
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("prefetch::window") {
+    TempDir dir;
+    const auto paths = files(dir.path);
+    std::vector<bf::path> seen;
+    cnf::Prefetcher prefetcher(paths, 3000, [&seen](const bf::path& file) {
+        seen.push_back(file);
+        return true;
+    });
+
+    prefetcher.advance(0);
+    CHECK(prefetcher.requested() == 3000);
+    prefetcher.advance(1);
+    CHECK(prefetcher.requested() == 4000);
+    // skipping ahead requests from there on
+    prefetcher.advance(8);
+    CHECK(prefetcher.requested() == 6000);
+    prefetcher.advance(9);
+    CHECK(prefetcher.requested() == 6000);
+
+    CHECK(seen == std::vector<bf::path>({paths[0], paths[1], paths[2],
+                                         paths[3], paths[8], paths[9]}));
+}
+
+TEST_CASE("prefetch::filter") {
+    TempDir dir;
+    const auto paths = files(dir.path);
+    cnf::Prefetcher prefetcher(paths, 2000, [&paths](const bf::path& file) {
+        return file != paths[1] && file != paths[2];
+    });
+
+    // skipped files do not take up the window
+    prefetcher.advance(0);
+    CHECK(prefetcher.requested() == 2000);
+    prefetcher.advance(3);
+    CHECK(prefetcher.requested() == 3000);
+}
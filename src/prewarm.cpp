@@ -0,0 +1,152 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "db.h"
+#include "manifest.h"
+#include "prewarm.h"
+#include "result_cache.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+// locked first of every file, it holds the tdb header and hash table
+const size_t HEAD_BYTES = 16 << 10;
+
+}  // namespace
+
+Prewarmer::Prewarmer(const string& database_path, const uint64_t lock_budget)
+    : m_lockBudget(lock_budget)
+    , m_pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+    , m_locked(0)
+    , m_lockFailed(false) {
+    map((bf::path(database_path) / Manifest::FILE_NAME).string());
+
+    vector<string> catalogs;
+    getCatalogs(database_path, catalogs);
+    for (const auto& catalog : catalogs) {
+        map((bf::path(database_path) / (catalog + ".tdb")).string());
+    }
+
+    map(ResultCache::default_path());
+
+    for (auto& mapping : m_mappings) {
+        lock(mapping, HEAD_BYTES);
+    }
+    for (auto& mapping : m_mappings) {
+        lock(mapping, mapping.length);
+    }
+}
+
+Prewarmer::~Prewarmer() {
+    for (const auto& mapping : m_mappings) {
+        munmap(mapping.address, mapping.length);
+    }
+}
+
+void Prewarmer::map(const string& path) {
+    // files that are missing are not needed by lookups either
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    const size_t length = static_cast<size_t>(st.st_size);
+    void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return;
+    }
+
+    // let the kernel read ahead, then fault in every page
+    madvise(address, length, MADV_WILLNEED);
+    const char* const begin = static_cast<const char*>(address);
+    volatile char sink = 0;
+    for (size_t offset = 0; offset < length; offset += m_pageSize) {
+        sink += begin[offset];
+    }
+    (void)sink;
+
+    m_mappings.push_back(Mapping{static_cast<char*>(address), length, 0});
+}
+
+void Prewarmer::lock(Mapping& mapping, const size_t length) {
+    if (m_lockFailed) {
+        return;
+    }
+    // in whole pages, so the locked ranges stay page aligned
+    const size_t begin = mapping.locked;
+    const size_t budget =
+        (m_lockBudget - m_locked) / m_pageSize * m_pageSize;
+    size_t end = (length + m_pageSize - 1) / m_pageSize * m_pageSize;
+    end = min(end, begin + budget);
+    end = min(end, mapping.length);
+    if (end <= begin) {
+        return;
+    }
+    if (mlock(mapping.address + begin, end - begin) != 0) {
+        m_lockFailed = true;
+        return;
+    }
+    m_locked += (end - begin + m_pageSize - 1) / m_pageSize * m_pageSize;
+    mapping.locked = end;
+}
+
+PrewarmStats Prewarmer::stats() const {
+    PrewarmStats stats;
+    stats.files = m_mappings.size();
+    stats.locked = m_locked;
+    stats.lock_failed = m_lockFailed;
+
+    vector<unsigned char> pages;
+    for (const auto& mapping : m_mappings) {
+        stats.bytes += mapping.length;
+        pages.resize((mapping.length + m_pageSize - 1) / m_pageSize);
+        if (mincore(mapping.address, mapping.length, pages.data()) != 0) {
+            continue;
+        }
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (pages[i] & 1) {
+                stats.resident +=
+                    min(m_pageSize, mapping.length - i * m_pageSize);
+            }
+        }
+    }
+    return stats;
+}
+
+}  // namespace cnf
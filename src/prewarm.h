@@ -0,0 +1,75 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PREWARM_H_
+#define PREWARM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnf {
+
+struct PrewarmStats {
+    size_t files = 0;
+    uint64_t bytes = 0;     // size of the mapped files
+    uint64_t resident = 0;  // bytes of them in the page cache, see mincore()
+    uint64_t locked = 0;
+    // mlock() was refused, e.g. for RLIMIT_MEMLOCK
+    bool lock_failed = false;
+};
+
+// Maps the manifest, the catalogs and the result cache of a database and
+// reads every page, so that the first lookup after boot or after the page
+// cache was dropped does not wait for the disk. Up to lock_budget bytes are
+// mlock()ed on top and stay resident as long as the Prewarmer lives. The
+// beginning of every file, where tdb keeps its hash table, is locked
+// before the remaining records of any catalog.
+class Prewarmer {
+public:
+    explicit Prewarmer(const std::string& database_path,
+                       uint64_t lock_budget = 0);
+    ~Prewarmer();
+    Prewarmer(const Prewarmer&) = delete;
+    Prewarmer& operator=(const Prewarmer&) = delete;
+
+    // the resident bytes are counted again on every call
+    PrewarmStats stats() const;
+
+private:
+    struct Mapping {
+        char* address;
+        size_t length;
+        size_t locked;  // bytes from the start
+    };
+
+    void map(const std::string& path);
+    void lock(Mapping& mapping, size_t length);
+
+    const uint64_t m_lockBudget;
+    const size_t m_pageSize;
+    std::vector<Mapping> m_mappings;
+    uint64_t m_locked;
+    bool m_lockFailed;
+};
+
+}  // namespace cnf
+
+#endif /* PREWARM_H_ */
@@ -0,0 +1,71 @@
+#include "prewarm.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "db_tdb.h"
+#include "manifest.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+void catalog(const bf::path& dir, const std::string& name) {
+    {
+        cnf::TdbDatabase db(name, false, dir.string());
+        for (int i = 0; i < 100; ++i) {
+            db.storePackage(cnf::Package("pkg" + std::to_string(i), "1.0", "1",
+                                         "x86_64", "xz",
+                                         {"cmd" + std::to_string(i)}));
+        }
+        db.flush();
+    }
+    cnf::Manifest::update(dir.string(), name);
+}
+
+}  // namespace
+
+TEST_CASE("prewarm::resident") {
+    TempDir dir;
+    catalog(dir.path, "core-x86_64");
+    catalog(dir.path, "extra-x86_64");
+
+    // where the result cache would be, there is none yet
+    setenv("XDG_RUNTIME_DIR", dir.path.c_str(), 1);
+    const cnf::Prewarmer prewarmer(dir.path.string());
+    const cnf::PrewarmStats stats = prewarmer.stats();
+    // the manifest and both catalogs
+    CHECK(stats.files == 3);
+    CHECK(stats.bytes > 0);
+    CHECK(stats.resident == stats.bytes);
+    CHECK(stats.locked == 0);
+}
+
+TEST_CASE("prewarm::lock_budget") {
+    TempDir dir;
+    catalog(dir.path, "core-x86_64");
+
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const cnf::Prewarmer prewarmer(dir.path.string(), page);
+    const cnf::PrewarmStats stats = prewarmer.stats();
+    CHECK(stats.locked <= page);
+    if (!stats.lock_failed) {
+        CHECK(stats.locked == page);
+    }
+}
+
+TEST_CASE("prewarm::missing_database") {
+    TempDir dir;
+    const cnf::Prewarmer prewarmer((dir.path / "missing").string(), 1 << 20);
+    CHECK(prewarmer.stats().files == 0);
+    CHECK(prewarmer.stats().locked == 0);
+}
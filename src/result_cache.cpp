@@ -0,0 +1,341 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+#include "hash.h"
+#include "result_cache.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+const char MAGIC[8] = {'c', 'n', 'f', 'c', 'a', 'c', 'h', 'e'};
+const uint32_t FORMAT_VERSION = 1;
+
+const size_t SLOT_SIZE = 4096;
+const size_t SLOT_COUNT = 1024;
+const size_t WAYS = 4;
+
+const char* const FILE_NAME = "cnf-lookup.cache";
+
+void put_u32(string& out, const uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string(string& out, const string& value) {
+    put_u32(out, value.size());
+    out.append(value);
+}
+
+bool get_u32(const unsigned char*& p,
+             const unsigned char* end,
+             uint32_t& value) {
+    if (static_cast<size_t>(end - p) < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return true;
+}
+
+bool get_string(const unsigned char*& p,
+                const unsigned char* end,
+                string& value) {
+    uint32_t size = 0;
+    if (!get_u32(p, end, size) || static_cast<size_t>(end - p) < size) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(p), size);
+    p += size;
+    return true;
+}
+
+}  // namespace
+
+struct ResultCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint64_t clock;
+};
+
+struct ResultCache::Slot {
+    uint32_t seq;  // odd while a writer owns the slot
+    uint32_t length;
+    uint64_t key;
+    uint64_t checksum;
+    uint64_t last_used;
+    unsigned char data[SLOT_SIZE - 32];
+};
+
+ResultCache::ResultCache(const string& path)
+    : m_fd(-1)
+    , m_map(nullptr)
+    , m_mapSize(SLOT_SIZE * (SLOT_COUNT + 1))
+    , m_header(nullptr)
+    , m_slots(nullptr) {
+    static_assert(sizeof(Slot) == SLOT_SIZE, "unexpected slot padding");
+
+    if (path.empty()) {
+        return;
+    }
+
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (m_fd < 0) {
+        return;
+    }
+
+    // only initialization is serialized, regular operation is lock free
+    flock(m_fd, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(m_fd, &st) == 0;
+    if (ok && static_cast<size_t>(st.st_size) != m_mapSize) {
+        ok = ftruncate(m_fd, 0) == 0 && ftruncate(m_fd, m_mapSize) == 0;
+    }
+    if (ok) {
+        m_map = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     m_fd, 0);
+        ok = m_map != MAP_FAILED;
+    }
+    if (ok) {
+        m_header = static_cast<Header*>(m_map);
+        if (memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            m_header->version != FORMAT_VERSION ||
+            m_header->slot_count != SLOT_COUNT) {
+            memset(m_map, 0, m_mapSize);
+            m_header->version = FORMAT_VERSION;
+            m_header->slot_count = SLOT_COUNT;
+            memcpy(m_header->magic, MAGIC, sizeof(MAGIC));
+        }
+        m_slots = reinterpret_cast<Slot*>(static_cast<char*>(m_map) +
+                                          SLOT_SIZE);
+    } else {
+        m_map = nullptr;
+    }
+    flock(m_fd, LOCK_UN);
+}
+
+ResultCache::~ResultCache() {
+    if (m_map) {
+        munmap(m_map, m_mapSize);
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+string ResultCache::default_path() {
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != nullptr && *runtime_dir != '\0') {
+        return (bf::path(runtime_dir) / FILE_NAME).string();
+    }
+    if (access(CACHE_PATH.c_str(), W_OK) == 0) {
+        return (bf::path(CACHE_PATH) / FILE_NAME).string();
+    }
+    return string();
+}
+
+ResultCache::Slot* ResultCache::slot(const size_t index) const {
+    return m_slots + index;
+}
+
+bool ResultCache::get(const uint64_t key,
+                      const string& ident,
+                      ResultMap& result,
+                      vector<string>* const inexact_matches) const {
+    if (!valid()) {
+        return false;
+    }
+
+    const size_t set = key % (SLOT_COUNT / WAYS);
+    Slot copy;
+
+    for (size_t way = 0; way < WAYS; ++way) {
+        Slot* const s = slot(set * WAYS + way);
+
+        const uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) != 0 || s->key != key) {
+            continue;
+        }
+        memcpy(&copy, s, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq ||
+            copy.key != key || copy.length > sizeof(copy.data) ||
+            hash_bytes(copy.data, copy.length, key) != copy.checksum) {
+            continue;
+        }
+
+        const unsigned char* p = copy.data;
+        const unsigned char* const end = copy.data + copy.length;
+
+        string stored_ident;
+        if (!get_string(p, end, stored_ident) || stored_ident != ident) {
+            continue;
+        }
+
+        vector<ResultMap::value_type> decoded;
+        vector<string> matches;
+        uint32_t catalogs = 0;
+        bool ok = get_u32(p, end, catalogs);
+        for (uint32_t c = 0; ok && c < catalogs; ++c) {
+            decoded.emplace_back();
+            string& catalog = decoded.back().first;
+            uint32_t packages = 0;
+            ok = get_string(p, end, catalog) && get_u32(p, end, packages);
+            for (uint32_t i = 0; ok && i < packages; ++i) {
+                string name, version, release, architecture, compression;
+                uint32_t file_count = 0;
+                ok = get_string(p, end, name) && get_string(p, end, version) &&
+                     get_string(p, end, release) &&
+                     get_string(p, end, architecture) &&
+                     get_string(p, end, compression) &&
+                     get_u32(p, end, file_count) &&
+                     file_count <= static_cast<size_t>(end - p) / sizeof(uint32_t);
+                vector<string> files(ok ? file_count : 0);
+                for (auto& file : files) {
+                    ok = ok && get_string(p, end, file);
+                }
+                if (ok) {
+                    decoded.back().second.emplace_back(
+                        move(name), move(version), move(release),
+                        move(architecture), move(compression), move(files));
+                }
+            }
+        }
+        uint32_t match_count = 0;
+        ok = ok && get_u32(p, end, match_count) &&
+             match_count <= static_cast<size_t>(end - p) / sizeof(uint32_t);
+        matches.resize(ok ? match_count : 0);
+        for (auto& match : matches) {
+            ok = ok && get_string(p, end, match);
+        }
+        if (!ok) {
+            continue;
+        }
+
+        __atomic_store_n(&s->last_used,
+                         __atomic_add_fetch(&m_header->clock, 1,
+                                            __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+
+        for (auto& group : decoded) {
+            result.insert(group.first, move(group.second));
+        }
+        if (inexact_matches) {
+            inexact_matches->insert(inexact_matches->end(), matches.begin(),
+                                    matches.end());
+        }
+        return true;
+    }
+    return false;
+}
+
+void ResultCache::put(const uint64_t key,
+                      const string& ident,
+                      const ResultMap& result,
+                      const vector<string>* const inexact_matches) {
+    if (!valid()) {
+        return;
+    }
+
+    string payload;
+    put_string(payload, ident);
+    put_u32(payload, result.size());
+    for (const auto& elem : result) {
+        put_string(payload, elem.first);
+        put_u32(payload, elem.second.size());
+        for (const auto& package : elem.second) {
+            put_string(payload, package.name());
+            put_string(payload, package.version());
+            put_string(payload, package.release());
+            put_string(payload, package.architecture());
+            put_string(payload, package.compression());
+            put_u32(payload, package.files().size());
+            for (const auto& file : package.files()) {
+                put_string(payload, file);
+            }
+        }
+    }
+    put_u32(payload, inexact_matches ? inexact_matches->size() : 0);
+    if (inexact_matches) {
+        for (const auto& match : *inexact_matches) {
+            put_string(payload, match);
+        }
+    }
+
+    if (payload.size() > sizeof(Slot::data)) {
+        return;  // large results are cheap compared to printing them anyway
+    }
+
+    // pick the slot holding this key, else the least recently used one
+    const size_t set = key % (SLOT_COUNT / WAYS);
+    Slot* victim = nullptr;
+    for (size_t way = 0; way < WAYS; ++way) {
+        Slot* const s = slot(set * WAYS + way);
+        if ((__atomic_load_n(&s->seq, __ATOMIC_RELAXED) & 1) != 0) {
+            continue;
+        }
+        if (s->key == key) {
+            victim = s;
+            break;
+        }
+        if (victim == nullptr ||
+            __atomic_load_n(&s->last_used, __ATOMIC_RELAXED) <
+                __atomic_load_n(&victim->last_used, __ATOMIC_RELAXED)) {
+            victim = s;
+        }
+    }
+    if (victim == nullptr) {
+        return;
+    }
+
+    uint32_t seq = __atomic_load_n(&victim->seq, __ATOMIC_RELAXED);
+    if ((seq & 1) != 0 ||
+        !__atomic_compare_exchange_n(&victim->seq, &seq, seq + 1, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;  // another writer is busy with it, skip caching
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    victim->key = key;
+    victim->length = payload.size();
+    memcpy(victim->data, payload.data(), payload.size());
+    victim->checksum = hash_bytes(victim->data, payload.size(), key);
+    victim->last_used =
+        __atomic_add_fetch(&m_header->clock, 1, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&victim->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+}  // namespace cnf
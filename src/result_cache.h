@@ -0,0 +1,82 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESULT_CACHE_H_
+#define RESULT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "db.h"
+
+namespace cnf {
+
+// Lookup results shared between processes through a memory mapped file.
+//
+// The file is a set associative table of fixed size slots. Every slot is
+// guarded by a sequence counter that is odd while a writer updates it, so
+// readers never lock: they copy the slot and retry nothing if the counter
+// moved. Within a set the least recently used slot is replaced.
+//
+// Keys must include everything the result depends on, in particular the
+// manifest stamp of the catalogs; stale entries are then simply never hit
+// again and age out.
+class ResultCache {
+public:
+    explicit ResultCache(const std::string& path);
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+    ~ResultCache();
+
+    // In $XDG_RUNTIME_DIR if set, CACHE_PATH otherwise. Never in the
+    // database directory: creating the file there would make its manifest
+    // stale. Keys include the database path, so databases share the file.
+    // Empty if there is no writable directory.
+    static std::string default_path();
+
+    bool valid() const { return m_slots != nullptr; }
+
+    // ident is the full, human readable form of the key and is compared on
+    // lookup, so hash collisions can not return a wrong result.
+    bool get(uint64_t key,
+             const std::string& ident,
+             ResultMap& result,
+             std::vector<std::string>* inexact_matches) const;
+    void put(uint64_t key,
+             const std::string& ident,
+             const ResultMap& result,
+             const std::vector<std::string>* inexact_matches);
+
+private:
+    struct Header;
+    struct Slot;
+
+    Slot* slot(size_t index) const;
+
+    int m_fd;
+    void* m_map;
+    size_t m_mapSize;
+    Header* m_header;
+    Slot* m_slots;
+};
+
+}  // namespace cnf
+
+#endif /* RESULT_CACHE_H_ */
@@ -28,9 +28,75 @@ using namespace std::string_literals;
 
 namespace cnf {
 
-std::vector<std::string> similar_words(const std::string& word) {
-    static const auto alphabet = "abcdefghijklmnopqrstuvwxyz-_0123456789"s;
+namespace {
+
+const auto alphabet = "abcdefghijklmnopqrstuvwxyz-_0123456789"s;
+
+size_t bigram_index(const char first, const char second) {
+    return static_cast<unsigned char>(first) * 256 +
+           static_cast<unsigned char>(second);
+}
+
+}  // namespace
+
+WordModel::WordModel() : m_bigrams(256 * 256) {}
+
+void WordModel::add(const std::string& word) {
+    char previous = BOUNDARY;
+    for (const char c : word) {
+        add_bigram(previous, c);
+        previous = c;
+    }
+    add_bigram(previous, BOUNDARY);
+    add_length(word.size(), 1);
+}
+
+void WordModel::add_bigram(const char first, const char second) {
+    m_bigrams[bigram_index(first, second)] = true;
+    m_chars.set(static_cast<unsigned char>(first));
+    m_chars.set(static_cast<unsigned char>(second));
+}
+
+void WordModel::add_length(const size_t length, const uint64_t count) {
+    m_lengths[length] += count;
+}
+
+void WordModel::merge(const WordModel& other) {
+    for (size_t i = 0; i < m_bigrams.size(); ++i) {
+        if (other.m_bigrams[i]) {
+            m_bigrams[i] = true;
+        }
+    }
+    m_chars |= other.m_chars;
+    for (const auto& elem : other.m_lengths) {
+        m_lengths[elem.first] += elem.second;
+    }
+}
+
+bool WordModel::has_char(const char c) const {
+    return m_chars.test(static_cast<unsigned char>(c));
+}
+
+bool WordModel::has_bigram(const char first, const char second) const {
+    return m_bigrams[bigram_index(first, second)];
+}
 
+bool WordModel::has_length(const size_t length) const {
+    return m_lengths.count(length) != 0;
+}
+
+std::vector<std::pair<char, char>> WordModel::bigrams() const {
+    std::vector<std::pair<char, char>> result;
+    for (size_t i = 0; i < m_bigrams.size(); ++i) {
+        if (m_bigrams[i]) {
+            result.emplace_back(static_cast<char>(i / 256),
+                                static_cast<char>(i % 256));
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> similar_words(const std::string& word) {
     std::vector<std::string> result;
     if (word.empty()) {
         return result;
@@ -72,4 +138,84 @@ std::vector<std::string> similar_words(const std::string& word) {
     return result;
 }
 
+std::vector<std::string> similar_words(const std::string& word,
+                                       const WordModel& model) {
+    std::vector<std::string> result;
+    if (word.empty()) {
+        return result;
+    }
+
+    std::string letters;
+    for (const auto& c : alphabet) {
+        if (model.has_char(c)) {
+            letters += c;
+        }
+    }
+
+    const char boundary = WordModel::BOUNDARY;
+    const size_t n = word.size();
+    const auto at = [&word, n, boundary](const size_t i) {
+        return i < n ? word[i] : boundary;
+    };
+
+    // left[i]: the bigrams of word[0, i) including its start are known,
+    // right[i]: those of word[i, n) including its end
+    std::vector<bool> left(n + 1, true);
+    std::vector<bool> right(n + 1, true);
+    for (size_t i = 1; i <= n; ++i) {
+        left[i] = left[i - 1] &&
+                  model.has_bigram(i > 1 ? word[i - 2] : boundary, word[i - 1]);
+    }
+    for (size_t i = n; i-- > 0;) {
+        right[i] = right[i + 1] && model.has_bigram(word[i], at(i + 1));
+    }
+
+    const bool shorter = model.has_length(n - 1);
+    const bool same = model.has_length(n);
+    const bool longer = model.has_length(n + 1);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!left[i]) {
+            // every candidate from here on keeps the unknown bigram
+            break;
+        }
+        const std::string head = word.substr(0, i);
+        const char before = i > 0 ? word[i - 1] : boundary;
+
+        if (i + 1 < n) {
+            // delete
+            if (shorter && right[i + 1] &&
+                model.has_bigram(before, word[i + 1])) {
+                result.emplace_back(head + word.substr(i + 1));
+            }
+            // transpose
+            if (same && right[i + 2] && model.has_bigram(before, word[i + 1]) &&
+                model.has_bigram(word[i + 1], word[i]) &&
+                model.has_bigram(word[i], at(i + 2))) {
+                result.emplace_back(head + word[i + 1] + word[i] +
+                                    word.substr(i + 2));
+            }
+        }
+
+        for (const auto& c : letters) {
+            if (!model.has_bigram(before, c)) {
+                continue;
+            }
+            // replaces
+            if (same && right[i + 1] && model.has_bigram(c, at(i + 1))) {
+                result.emplace_back(head + c + word.substr(i + 1));
+            }
+            // inserts
+            if (longer && right[i] && model.has_bigram(c, word[i])) {
+                result.emplace_back(head + c + word.substr(i));
+            }
+        }
+    }
+
+    sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
 }  // namespace cnf
@@ -19,13 +19,51 @@
 #ifndef SIMILAR_H_
 #define SIMILAR_H_
 
+#include <bitset>
+#include <cstdint>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace cnf {
 
+// Which characters, pairs of adjacent characters and lengths the command
+// names of a catalog have.
+class WordModel {
+public:
+    // stands for the start and the end of a word in bigrams
+    static const char BOUNDARY = '\0';
+
+    WordModel();
+
+    void add(const std::string& word);
+    void add_bigram(char first, char second);
+    void add_length(size_t length, uint64_t count);
+    void merge(const WordModel& other);
+
+    bool has_char(char c) const;
+    bool has_bigram(char first, char second) const;
+    bool has_length(size_t length) const;
+
+    std::vector<std::pair<char, char>> bigrams() const;
+    // number of names per length
+    const std::map<size_t, uint64_t>& lengths() const { return m_lengths; }
+
+private:
+    std::bitset<256> m_chars;
+    std::vector<bool> m_bigrams;
+    std::map<size_t, uint64_t> m_lengths;
+};
+
 std::vector<std::string> similar_words(const std::string& word);
 
+// similar_words() without the candidates that can not be the name of a
+// command described by model: the edits only use characters of the model,
+// every bigram of a candidate and its length must occur in it.
+std::vector<std::string> similar_words(const std::string& word,
+                                       const WordModel& model);
+
 }  // namespace cnf
 
 #endif /* SIMILAR_H_ */
@@ -1,5 +1,8 @@
 #include "similar.h"
 
+#include <algorithm>
+#include <random>
+
 #include <catch2/catch.hpp>
 
 template <typename... Args>
@@ -68,3 +71,67 @@ TEST_CASE("similar::long_string") {
     CHECK(result.size() == 37891);
 }
 
+
+namespace {
+
+// whether word could be one of the names model was built from
+bool admitted(const cnf::WordModel& model, const std::string& word) {
+    char previous = cnf::WordModel::BOUNDARY;
+    for (const char c : word) {
+        if (!model.has_bigram(previous, c)) {
+            return false;
+        }
+        previous = c;
+    }
+    return model.has_bigram(previous, cnf::WordModel::BOUNDARY) &&
+           model.has_length(word.size());
+}
+
+}  // namespace
+
+TEST_CASE("similar::model_prunes_candidates") {
+    cnf::WordModel model;
+    for (const auto& name : {"git", "gitk", "grep", "vi", "vim"}) {
+        model.add(name);
+    }
+
+    const auto result = cnf::similar_words("gti", model);
+    CHECK(std::find(result.begin(), result.end(), "git") != result.end());
+    CHECK(result.size() < cnf::similar_words("gti").size() / 10);
+    for (const auto& word : result) {
+        CHECK(admitted(model, word));
+    }
+
+    // no command is that long, nothing is left
+    CHECK(cnf::similar_words("gitgitgit", model).empty());
+    CHECK(cnf::similar_words("", model).empty());
+}
+
+TEST_CASE("similar::model_keeps_admitted_candidates") {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter('a', 'h');
+    std::uniform_int_distribution<size_t> length(1, 8);
+    const auto random_word = [&]() {
+        std::string word;
+        for (size_t i = length(rng); i > 0; --i) {
+            word += static_cast<char>(letter(rng));
+        }
+        return word;
+    };
+
+    cnf::WordModel model;
+    for (int i = 0; i < 200; ++i) {
+        model.add(random_word());
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        const std::string word = random_word();
+        std::vector<std::string> expected;
+        for (const auto& candidate : cnf::similar_words(word)) {
+            if (admitted(model, candidate)) {
+                expected.push_back(candidate);
+            }
+        }
+        CHECK(cnf::similar_words(word, model) == expected);
+    }
+}
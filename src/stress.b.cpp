@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+#include "db.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+// Lookup latency and throughput with many concurrent readers, optionally
+// while a writer keeps repopulating the catalog. Readers are processes:
+// that is how shells use the catalogs, and tdb does not open a file twice in
+// one process anyway.
+
+namespace {
+
+const unsigned SEED = 42;
+const char* const CATALOG = "stress-x86_64";
+
+struct Settings {
+    std::vector<unsigned> readers = {1, 2, 4, 8};
+    double seconds = 2;
+    bool writer = false;
+    bool inexact = false;
+    unsigned packages = 300;
+    std::string database_path;
+    std::string package_path;
+    bool generated = false;
+};
+
+void usage() {
+    std::cerr
+        << "Usage: bench-stress [options]\n"
+           " -r <n,n,...>  reader counts to measure (default 1,2,4,8)\n"
+           " -t <seconds>  duration per reader count (default 2)\n"
+           " -w            repopulate the catalog concurrently\n"
+           " -i            look up similar commands instead of exact ones\n"
+           " -n <count>    packages of the generated catalog (default 300)\n"
+           " -d <path>     use the catalogs in path instead of generating one\n"
+           " -p <path>     packages the writer indexes into the first catalog "
+           "of -d\n";
+    exit(1);
+}
+
+// each package provides 20 commands, half of them shared with others
+void write_package(const bf::path& dir,
+                   const unsigned index,
+                   const std::string& version) {
+    const bf::path path = dir / ("pkg" + std::to_string(index) + "-" +
+                                 version + "-1-x86_64.pkg.tar.gz");
+    std::mt19937 rng(SEED + index);
+
+    std::vector<std::string> entries;
+    for (unsigned i = 0; i < 20; ++i) {
+        entries.push_back(
+            "usr/bin/" + (i % 2 == 0 ? "p" + std::to_string(index) + "c" +
+                                           std::to_string(i)
+                                     : "cmd" + std::to_string(rng() % 2000)));
+    }
+    cnf::test::write_package(path, entries);
+}
+
+// Two versions of every package, the writer alternates between them so
+// that every pass really rewrites the catalog.
+void generate(const bf::path& dir, const unsigned packages) {
+    for (const auto* version : {"1.0", "2.0"}) {
+        const bf::path sub = dir / "packages" / version;
+        bf::create_directories(sub);
+        for (unsigned i = 0; i < packages; ++i) {
+            write_package(sub, i, version);
+        }
+    }
+    cnf::populate(dir / "packages" / "1.0", (dir / "db").string(), CATALOG,
+                  true, 0);
+}
+
+// what the readers look up: names of the catalogs and misses
+std::vector<std::string> terms(const std::string& database_path) {
+    std::vector<std::string> result;
+    std::vector<std::string> catalogs;
+    cnf::getCatalogs(database_path, catalogs);
+    for (const auto& catalog : catalogs) {
+        try {
+            cnf::getDatabase(catalog, true, database_path)->getCommands(result);
+        } catch (const cnf::DatabaseException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    std::mt19937 rng(SEED);
+    std::shuffle(result.begin(), result.end(), rng);
+    result.resize(std::min<size_t>(result.size(), 10000));
+    for (size_t i = 0, misses = result.size() / 4 + 1; i < misses; ++i) {
+        result.push_back("missing" + std::to_string(i));
+    }
+    return result;
+}
+
+// Runs lookups until the time is up and writes the latencies in
+// microseconds to fd.
+void read_catalogs(const Settings& settings,
+                   const std::vector<std::string>& words,
+                   const unsigned seed,
+                   const int start,
+                   const int fd) {
+    // released when the parent closes its end
+    char byte;
+    while (read(start, &byte, 1) > 0) {
+    }
+
+    cnf::LookupOptions options;
+    options.use_cache = false;
+
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> latencies;
+    const auto end = std::chrono::steady_clock::now() +
+                     std::chrono::duration<double>(settings.seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        const std::string& word = words[rng() % words.size()];
+        cnf::ResultMap result;
+        std::vector<std::string> matches;
+        const auto begin = std::chrono::steady_clock::now();
+        cnf::lookup(word, settings.database_path, result,
+                    settings.inexact ? &matches : nullptr, options);
+        latencies.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin)
+                .count()));
+    }
+
+    const char* data = reinterpret_cast<const char*>(latencies.data());
+    size_t left = latencies.size() * sizeof(uint32_t);
+    while (left > 0) {
+        const ssize_t written = write(fd, data, left);
+        if (written <= 0) {
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+}
+
+// A generated fixture alternates between the versions of its packages,
+// other package paths are indexed from scratch in every pass.
+void populate_forever(const Settings& settings) {
+    std::vector<std::string> catalogs;
+    cnf::getCatalogs(settings.database_path, catalogs);
+    const bf::path path(settings.package_path);
+    for (unsigned pass = 0;; ++pass) {
+        if (settings.generated) {
+            cnf::populate(path / (pass % 2 == 0 ? "2.0" : "1.0"),
+                          settings.database_path, catalogs[0], false, 0);
+        } else {
+            cnf::populate(path, settings.database_path, catalogs[0], true, 0);
+        }
+    }
+}
+
+struct Result {
+    double throughput;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t p999;
+};
+
+Result measure(const Settings& settings,
+               const std::vector<std::string>& words,
+               const unsigned readers) {
+    int start[2];
+    if (pipe(start) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    std::vector<pid_t> pids;
+    std::vector<int> fds;
+    for (unsigned i = 0; i < readers; ++i) {
+        int out[2];
+        if (pipe(out) != 0) {
+            perror("pipe");
+            exit(1);
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(start[1]);
+            close(out[0]);
+            read_catalogs(settings, words, SEED + i, start[0], out[1]);
+            _exit(0);
+        }
+        close(out[1]);
+        pids.push_back(pid);
+        fds.push_back(out[0]);
+    }
+
+    pid_t writer = -1;
+    if (settings.writer) {
+        writer = fork();
+        if (writer == 0) {
+            populate_forever(settings);
+            _exit(0);
+        }
+    }
+
+    close(start[0]);
+    close(start[1]);
+
+    // read while the readers write, the pipes would fill up otherwise
+    std::vector<uint32_t> latencies;
+    for (const int fd : fds) {
+        uint32_t buffer[4096];
+        ssize_t length = 0;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            latencies.insert(latencies.end(), buffer,
+                             buffer + length / sizeof(uint32_t));
+        }
+        close(fd);
+    }
+    for (const pid_t pid : pids) {
+        waitpid(pid, nullptr, 0);
+    }
+    if (writer > 0) {
+        kill(writer, SIGKILL);
+        waitpid(writer, nullptr, 0);
+    }
+
+    Result result = {0, 0, 0, 0};
+    if (latencies.empty()) {
+        return result;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](const double q) {
+        return latencies[std::min(latencies.size() - 1,
+                                  static_cast<size_t>(q * latencies.size()))];
+    };
+    result.throughput = latencies.size() / settings.seconds;
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    return result;
+}
+
+std::vector<unsigned> parse_counts(const std::string& list) {
+    std::vector<unsigned> result;
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        const long count = strtol(item.c_str(), nullptr, 10);
+        if (count < 1) {
+            usage();
+        }
+        result.push_back(static_cast<unsigned>(count));
+    }
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "r:t:win:d:p:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                settings.readers = parse_counts(optarg);
+                break;
+            case 't':
+                settings.seconds = strtod(optarg, nullptr);
+                break;
+            case 'w':
+                settings.writer = true;
+                break;
+            case 'i':
+                settings.inexact = true;
+                break;
+            case 'n':
+                settings.packages = strtoul(optarg, nullptr, 10);
+                break;
+            case 'd':
+                settings.database_path = optarg;
+                break;
+            case 'p':
+                settings.package_path = optarg;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (settings.seconds <= 0 || settings.readers.empty() ||
+        settings.packages == 0 ||
+        (settings.writer && !settings.database_path.empty() &&
+         settings.package_path.empty())) {
+        usage();
+    }
+
+    bf::path fixture;
+    if (settings.database_path.empty()) {
+        fixture = bf::temp_directory_path() /
+                  bf::unique_path("cnf-stress-%%%%-%%%%");
+        generate(fixture, settings.packages);
+        settings.database_path = (fixture / "db").string();
+        settings.package_path = (fixture / "packages").string();
+        settings.generated = true;
+    }
+
+    const std::vector<std::string> words = terms(settings.database_path);
+    if (words.empty()) {
+        std::cerr << "no commands in " << settings.database_path << std::endl;
+        return 1;
+    }
+
+    printf("%8s %7s %12s %9s %9s %9s\n", "readers", "writer", "lookups/s",
+           "p50_us", "p99_us", "p999_us");
+    for (const unsigned readers : settings.readers) {
+        const Result r = measure(settings, words, readers);
+        printf("%8u %7s %12.0f %9u %9u %9u\n", readers,
+               settings.writer ? "yes" : "no", r.throughput, r.p50, r.p99,
+               r.p999);
+        fflush(stdout);
+    }
+
+    if (!fixture.empty()) {
+        bf::remove_all(fixture);
+    }
+    return 0;
+}
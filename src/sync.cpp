@@ -0,0 +1,209 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <getopt.h>
+#include <sys/utsname.h>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "config.h"
+#include "mirror.h"
+
+using namespace cnf;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+static struct args_t {
+    string database_path;
+    SyncOptions options;
+} args;
+
+#ifdef WITH_ZSTD
+static const char* OPT_STRING = "d:m:a:j:r:PFvh?";
+#else
+static const char* OPT_STRING = "d:m:a:j:r:vh?";
+#endif
+
+static const struct option LONG_OPTS[] = {
+    {"database-path", required_argument, nullptr, 'd'},
+    {"mirror", required_argument, nullptr, 'm'},
+    {"arch", required_argument, nullptr, 'a'},
+    {"connections", required_argument, nullptr, 'j'},
+    {"retries", required_argument, nullptr, 'r'},
+#ifdef WITH_ZSTD
+    {"no-packs", no_argument, nullptr, 'P'},
+    {"no-file-lists", no_argument, nullptr, 'F'},
+#endif
+    {"verbose", no_argument, nullptr, 'v'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, no_argument, nullptr, 0}};
+
+void usage() {
+    cout << format(translate("       *** %s %s ***                             "
+                             "                     \n")) %
+                PROGRAM_NAME % VERSION_LONG
+         << translate(
+                "Usage:                                                        "
+                "        \n")
+         << translate(
+                "   cnf-sync [ -d <path> ] [ -m <mirror> ]                     "
+                "        \n")
+         << translate(
+                "                                                              "
+                "        \n")
+         << translate(
+                "Options:                                                      "
+                "        \n")
+         << translate(
+                " --help            -? -h     Show this help and exit          "
+                "        \n")
+         << translate(
+                " --verbose         -v        Display verbose output           "
+                "        \n")
+         << translate(
+                "                                                              "
+                "        \n")
+         << format(translate(" --database-path   -d        Customize the "
+                             "database lookup path       \n"
+                             "                             default is %s       "
+                             "                     \n")) %
+                DATABASE_PATH
+         << format(translate(" --mirror          -m        Mirror URL or "
+                             "directory                  \n"
+                             "                             default is %s  \n")) %
+                MIRROR_URL
+         << translate(
+                " --arch            -a        Architecture of the catalogs     "
+                "        \n")
+         << translate(
+                " --connections     -j        Number of concurrent downloads   "
+                "        \n")
+         << translate(
+                " --retries         -r        Retries per file                 "
+                "        \n")
+#ifdef WITH_ZSTD
+         << translate(
+                " --no-packs        -P        Download the plain catalogs, even"
+                " if the\n"
+                "                             mirror publishes compressed packs"
+                "        \n")
+         << translate(
+                " --no-file-lists   -F        Fetch only what lookups need from"
+                " packs,\n"
+                "                             results show no file lists       "
+                "        \n")
+#endif
+         << endl;
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    boost::locale::generator gen;
+    gen.add_messages_path(LC_MESSAGE_PATH);
+    gen.add_messages_domain(PROGRAM_NAME);
+    locale::global(gen(""));
+    cout.imbue(locale());
+
+    args.database_path = DATABASE_PATH;
+    args.options.mirror = MIRROR_URL;
+
+    struct utsname name;
+    if (uname(&name) == 0) {
+        args.options.architecture = name.machine;
+    }
+
+    int opt(0), long_index(0);
+
+    opt = getopt_long(argc, argv, OPT_STRING, LONG_OPTS, &long_index);
+    while (opt != -1) {
+        switch (opt) {
+            case 'd':
+                args.database_path = optarg;
+                break;
+            case 'm':
+                args.options.mirror = optarg;
+                break;
+            case 'a':
+                args.options.architecture = optarg;
+                break;
+            case 'j': {
+                const long connections = strtol(optarg, nullptr, 10);
+                if (connections < 1) {
+                    usage();
+                }
+                args.options.connections = static_cast<unsigned>(connections);
+                break;
+            }
+            case 'r': {
+                const long retries = strtol(optarg, nullptr, 10);
+                if (retries < 0) {
+                    usage();
+                }
+                args.options.retries = static_cast<unsigned>(retries);
+                break;
+            }
+#ifdef WITH_ZSTD
+            case 'P':
+                args.options.packs = false;
+                break;
+            case 'F':
+                args.options.file_lists = false;
+                break;
+#endif
+            case 'v':
+                args.options.verbosity++;
+                break;
+            case 'h':
+            case '?':
+                usage();
+                break;
+            default:
+                break;
+        }
+        opt = getopt_long(argc, argv, OPT_STRING, LONG_OPTS, &long_index);
+    }
+
+    if (argc - optind != 0 || args.options.architecture.empty()) {
+        usage();
+    }
+
+    SyncStats stats;
+    try {
+        if (!sync_catalogs(args.database_path, args.options, stats)) {
+            cerr << translate("Could not download catalog file ... aborting")
+                 << endl;
+            return 1;
+        }
+    } catch (const boost::filesystem::filesystem_error& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    cout << format(translate("%d catalogs updated, %d unchanged, %d failed "
+                             "(%d bytes downloaded)")) %
+                stats.updated % stats.unchanged % stats.failed % stats.bytes
+         << endl;
+    return stats.failed == 0 ? 0 : 1;
+}
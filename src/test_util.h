@@ -0,0 +1,67 @@
+#ifndef TEST_UTIL_H_
+#define TEST_UTIL_H_
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <boost/filesystem.hpp>
+
+// Fixtures shared by the tests and benchmarks.
+
+namespace cnf {
+namespace test {
+
+// a fresh directory, removed with everything in it
+struct TempDir {
+    TempDir()
+        : path(boost::filesystem::temp_directory_path() /
+               boost::filesystem::unique_path("cnf-test-%%%%-%%%%")) {
+        boost::filesystem::create_directories(path);
+    }
+    ~TempDir() { boost::filesystem::remove_all(path); }
+    const boost::filesystem::path path;
+};
+
+// A package file at path holding an empty file for each of entries, like
+// "usr/bin/ls". The entries have a fixed modification time, so the same
+// entries give the same file.
+inline void write_package(const boost::filesystem::path& path,
+                          const std::vector<std::string>& entries) {
+    struct archive* arc = archive_write_new();
+    archive_write_add_filter_gzip(arc);
+    archive_write_set_format_pax_restricted(arc);
+    archive_write_open_filename(arc, path.c_str());
+    for (const auto& name : entries) {
+        struct archive_entry* entry = archive_entry_new();
+        archive_entry_set_pathname(entry, name.c_str());
+        archive_entry_set_size(entry, 0);
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0755);
+        archive_entry_set_mtime(entry, 0, 0);
+        archive_write_header(arc, entry);
+        archive_entry_free(entry);
+    }
+    archive_write_close(arc);
+    archive_write_free(arc);
+}
+
+// A word of length letters from 'a' to last. A small alphabet gives many
+// words that are near each other or share substrings.
+inline std::string random_word(std::mt19937& rng,
+                               const size_t length,
+                               const char last = 'z') {
+    std::uniform_int_distribution<int> letter('a', last);
+    std::string word;
+    for (size_t i = 0; i < length; ++i) {
+        word += static_cast<char>(letter(rng));
+    }
+    return word;
+}
+
+}  // namespace test
+}  // namespace cnf
+
+#endif /* TEST_UTIL_H_ */
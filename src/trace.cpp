@@ -0,0 +1,95 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include <boost/format.hpp>
+
+#include "trace.h"
+
+using namespace std;
+using boost::format;
+
+namespace cnf {
+namespace trace {
+
+namespace {
+
+const char* const PHASE_NAMES[PHASE_COUNT] = {
+    "locale", "catalogs", "db_open", "db_fetch", "similar", "format"};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {"probes", "fetches",
+                                                  "bytes_read", "cache_hits"};
+
+atomic<bool> g_enabled(false);
+
+// taken when the library is loaded, i.e. close to process start
+const chrono::steady_clock::time_point g_start = chrono::steady_clock::now();
+
+// counters are updated from lookup worker threads as well
+atomic<uint64_t> g_phaseNanos[PHASE_COUNT];
+atomic<uint64_t> g_phaseCalls[PHASE_COUNT];
+atomic<uint64_t> g_counters[COUNTER_COUNT];
+
+}  // namespace
+
+void enable(const bool on) {
+    g_enabled = on;
+}
+
+bool enabled() {
+    return g_enabled.load(memory_order_relaxed);
+}
+
+void add_time(const Phase phase, const chrono::steady_clock::duration elapsed) {
+    const auto nanos =
+        chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+    g_phaseNanos[phase].fetch_add(nanos, memory_order_relaxed);
+    g_phaseCalls[phase].fetch_add(1, memory_order_relaxed);
+}
+
+void add_count(const Counter counter, const uint64_t n) {
+    g_counters[counter].fetch_add(n, memory_order_relaxed);
+}
+
+void report(ostream& out) {
+#ifdef WITH_TRACE
+    const auto total = chrono::duration_cast<chrono::nanoseconds>(
+                           chrono::steady_clock::now() - g_start)
+                           .count();
+
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        out << format("trace: %-10s %10.3f ms %8d calls\n") %
+                   PHASE_NAMES[phase] % (g_phaseNanos[phase].load() / 1e6) %
+                   g_phaseCalls[phase].load();
+    }
+    out << format("trace: %-10s %10.3f ms\n") % "total" % (total / 1e6);
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter) {
+        out << format("trace: %-10s %10d\n") % COUNTER_NAMES[counter] %
+                   g_counters[counter].load();
+    }
+#else
+    out << "trace: support not compiled in (WITH_TRACE=OFF)" << endl;
+#endif
+}
+
+}  // namespace trace
+}  // namespace cnf
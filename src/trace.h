@@ -0,0 +1,106 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "config.h"
+
+namespace cnf {
+namespace trace {
+
+enum Phase {
+    PHASE_LOCALE,
+    PHASE_CATALOGS,
+    PHASE_DB_OPEN,
+    PHASE_DB_FETCH,
+    PHASE_SIMILAR,
+    PHASE_FORMAT,
+    PHASE_COUNT
+};
+
+enum Counter {
+    COUNTER_PROBES,
+    COUNTER_FETCHES,
+    COUNTER_BYTES_READ,
+    COUNTER_CACHE_HITS,
+    COUNTER_COUNT
+};
+
+// Tracing is off until explicitly enabled, so an instrumented build only pays
+// for one branch per trace point.
+void enable(bool on = true);
+bool enabled();
+
+void add_time(Phase phase, std::chrono::steady_clock::duration elapsed);
+void add_count(Counter counter, uint64_t n = 1);
+
+// Print the accumulated timings and counters.
+void report(std::ostream& out);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase)
+        : m_phase(phase)
+        , m_active(enabled())
+        , m_start(m_active ? std::chrono::steady_clock::now()
+                           : std::chrono::steady_clock::time_point()) {}
+    ~ScopedTimer() {
+        if (m_active) {
+            add_time(m_phase, std::chrono::steady_clock::now() - m_start);
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const Phase m_phase;
+    const bool m_active;
+    const std::chrono::steady_clock::time_point m_start;
+};
+
+}  // namespace trace
+}  // namespace cnf
+
+#define CNF_TRACE_CONCAT_(a, b) a##b
+#define CNF_TRACE_CONCAT(a, b) CNF_TRACE_CONCAT_(a, b)
+
+#ifdef WITH_TRACE
+#define CNF_TRACE_SCOPE(phase)                         \
+    const ::cnf::trace::ScopedTimer CNF_TRACE_CONCAT( \
+        cnf_trace_timer_, __LINE__)(::cnf::trace::phase)
+#define CNF_TRACE_COUNT(counter, n)                          \
+    do {                                                     \
+        if (::cnf::trace::enabled()) {                       \
+            ::cnf::trace::add_count(::cnf::trace::counter, n); \
+        }                                                    \
+    } while (false)
+#else
+#define CNF_TRACE_SCOPE(phase) \
+    do {                       \
+    } while (false)
+#define CNF_TRACE_COUNT(counter, n) \
+    do {                            \
+    } while (false)
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,290 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "little_endian.h"
+#include "trigram_index.h"
+
+using namespace std;
+
+namespace cnf {
+
+namespace {
+
+const char INDEX_MAGIC[4] = {'C', 'N', 'F', 'T'};
+const uint32_t INDEX_VERSION = 1;
+
+// magic, version, number of names and trigrams, size of the names
+const size_t HEADER_SIZE = 20;
+// trigram, offset of its posting list, number of names in the list
+const size_t ENTRY_SIZE = 12;
+
+const size_t TRIGRAM = 3;
+
+void put_varint(string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+uint32_t trigram(const char* s) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(s);
+    return static_cast<uint32_t>(bytes[0]) << 16 |
+           static_cast<uint32_t>(bytes[1]) << 8 | bytes[2];
+}
+
+// Decodes a posting list one id at a time; corrupt lists end early.
+class PostingReader {
+public:
+    PostingReader(const char* begin, const char* end, const uint32_t count)
+        : m_pos(begin), m_end(end), m_left(count), m_id(0), m_first(true) {}
+
+    bool next(uint32_t& id) {
+        if (m_left == 0) {
+            return false;
+        }
+        uint32_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            if (m_pos == m_end || shift > 28) {
+                m_left = 0;
+                return false;
+            }
+            const auto byte = static_cast<unsigned char>(*m_pos++);
+            delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        --m_left;
+        m_id = m_first ? delta : m_id + delta;
+        m_first = false;
+        id = m_id;
+        return true;
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+    uint32_t m_left;
+    uint32_t m_id;
+    bool m_first;
+};
+
+}  // namespace
+
+string TrigramIndex::build(const vector<string>& names) {
+    // ids are visited in ascending order, so every list is sorted
+    unordered_map<uint32_t, vector<uint32_t>> lists;
+    for (uint32_t id = 0; id < names.size(); ++id) {
+        const string& name = names[id];
+        for (size_t i = 0; i + TRIGRAM <= name.size(); ++i) {
+            vector<uint32_t>& list = lists[trigram(name.data() + i)];
+            if (list.empty() || list.back() != id) {
+                list.push_back(id);
+            }
+        }
+    }
+    vector<uint32_t> trigrams;
+    trigrams.reserve(lists.size());
+    for (const auto& elem : lists) {
+        trigrams.push_back(elem.first);
+    }
+    sort(trigrams.begin(), trigrams.end());
+
+    string result(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    size_t names_size = 0;
+    for (const auto& name : names) {
+        names_size += name.size();
+    }
+    put_u32(result, INDEX_VERSION);
+    put_u32(result, static_cast<uint32_t>(names.size()));
+    put_u32(result, static_cast<uint32_t>(trigrams.size()));
+    put_u32(result, static_cast<uint32_t>(names_size));
+
+    uint32_t offset = 0;
+    for (const auto& name : names) {
+        put_u32(result, offset);
+        offset += static_cast<uint32_t>(name.size());
+    }
+    put_u32(result, offset);
+    for (const auto& name : names) {
+        result += name;
+    }
+
+    string postings;
+    for (const uint32_t key : trigrams) {
+        const vector<uint32_t>& list = lists[key];
+        put_u32(result, key);
+        put_u32(result, static_cast<uint32_t>(postings.size()));
+        put_u32(result, static_cast<uint32_t>(list.size()));
+
+        uint32_t previous = 0;
+        for (const uint32_t id : list) {
+            put_varint(postings, id - previous);
+            previous = id;
+        }
+    }
+    result += postings;
+    return result;
+}
+
+TrigramIndex::TrigramIndex(const char* data, const size_t size)
+    : m_offsets(nullptr)
+    , m_names(nullptr)
+    , m_table(nullptr)
+    , m_postings(nullptr)
+    , m_end(data + size)
+    , m_count(0)
+    , m_trigrams(0)
+    , m_namesSize(0) {
+    if (size < HEADER_SIZE ||
+        memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        get_u32(data + 4) != INDEX_VERSION) {
+        return;
+    }
+    const uint64_t count = get_u32(data + 8);
+    const uint64_t trigrams = get_u32(data + 12);
+    const uint64_t names_size = get_u32(data + 16);
+    if (HEADER_SIZE + 4 * (count + 1) + names_size + ENTRY_SIZE * trigrams >
+        size) {
+        return;
+    }
+    m_count = static_cast<uint32_t>(count);
+    m_trigrams = static_cast<uint32_t>(trigrams);
+    m_namesSize = static_cast<uint32_t>(names_size);
+    m_offsets = data + HEADER_SIZE;
+    m_table = m_offsets + 4 * (count + 1) + names_size;
+    m_postings = m_table + ENTRY_SIZE * trigrams;
+    m_names = m_offsets + 4 * (count + 1);
+}
+
+bool TrigramIndex::postings(const uint32_t trigram, Postings& list) const {
+    uint32_t low = 0;
+    uint32_t high = m_trigrams;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        const uint32_t key = get_u32(m_table + ENTRY_SIZE * middle);
+        if (key < trigram) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == m_trigrams || get_u32(m_table + ENTRY_SIZE * low) != trigram) {
+        return false;
+    }
+    const char* entry = m_table + ENTRY_SIZE * low;
+    const uint32_t offset = get_u32(entry + 4);
+    if (offset > static_cast<size_t>(m_end - m_postings)) {
+        return false;
+    }
+    list.begin = m_postings + offset;
+    list.count = get_u32(entry + 8);
+    return true;
+}
+
+bool TrigramIndex::name(const uint32_t id, string& out) const {
+    const uint32_t begin = get_u32(m_offsets + 4 * id);
+    const uint32_t end = get_u32(m_offsets + 4 * (id + 1));
+    if (begin > end || end > m_namesSize) {
+        return false;
+    }
+    out.assign(m_names + begin, end - begin);
+    return true;
+}
+
+void TrigramIndex::find(const string& part, vector<string>& result) const {
+    if (!valid()) {
+        return;
+    }
+
+    string candidate;
+    if (part.size() < TRIGRAM) {
+        for (uint32_t id = 0; id < m_count; ++id) {
+            if (name(id, candidate) &&
+                candidate.find(part) != string::npos) {
+                result.push_back(candidate);
+            }
+        }
+        return;
+    }
+
+    vector<Postings> lists;
+    for (size_t i = 0; i + TRIGRAM <= part.size(); ++i) {
+        Postings list;
+        if (!postings(trigram(part.data() + i), list)) {
+            return;
+        }
+        lists.push_back(list);
+    }
+    // the shortest list bounds the candidates, a trigram occurring twice in
+    // part is only intersected once
+    sort(lists.begin(), lists.end(),
+         [](const Postings& lhs, const Postings& rhs) {
+             return lhs.count < rhs.count ||
+                    (lhs.count == rhs.count && lhs.begin < rhs.begin);
+         });
+    lists.erase(unique(lists.begin(), lists.end(),
+                       [](const Postings& lhs, const Postings& rhs) {
+                           return lhs.begin == rhs.begin;
+                       }),
+                lists.end());
+
+    vector<uint32_t> ids;
+    ids.reserve(lists[0].count);
+    PostingReader first(lists[0].begin, m_end, lists[0].count);
+    for (uint32_t id = 0; first.next(id);) {
+        ids.push_back(id);
+    }
+    for (size_t i = 1; i < lists.size() && !ids.empty(); ++i) {
+        PostingReader reader(lists[i].begin, m_end, lists[i].count);
+        uint32_t id = 0;
+        bool more = reader.next(id);
+        size_t kept = 0;
+        for (const uint32_t wanted : ids) {
+            while (more && id < wanted) {
+                more = reader.next(id);
+            }
+            if (!more) {
+                break;
+            }
+            if (id == wanted) {
+                ids[kept++] = wanted;
+            }
+        }
+        ids.resize(kept);
+    }
+
+    // the trigrams may be anywhere in a candidate, in any order
+    for (const uint32_t id : ids) {
+        if (id < m_count && name(id, candidate) &&
+            candidate.find(part) != string::npos) {
+            result.push_back(candidate);
+        }
+    }
+}
+
+}  // namespace cnf
@@ -0,0 +1,76 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TRIGRAM_INDEX_H_
+#define TRIGRAM_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnf {
+
+// The command names of a catalog indexed by their trigrams, the substrings
+// of three characters. Every trigram has a posting list of the names
+// containing it, ascending ids delta encoded as varints, so the names
+// containing a string are the intersection of the lists of its trigrams,
+// without looking at any other name.
+//
+// The index is serialized into one record and queried in place: a header,
+// the offsets of the names, the names, a table of (trigram, offset, count)
+// sorted by trigram and the posting lists.
+class TrigramIndex {
+public:
+    // The serialized index of names, which have to be sorted and unique.
+    static std::string build(const std::vector<std::string>& names);
+
+    // The index serialized at data, which has to outlive it.
+    explicit TrigramIndex(const char* data, size_t size);
+
+    // false if data is no index written by build()
+    bool valid() const { return m_names != nullptr; }
+    size_t size() const { return m_count; }
+
+    // Appends the names containing part in sorted order. Parts shorter than
+    // a trigram are looked for in all names.
+    void find(const std::string& part, std::vector<std::string>& result) const;
+
+private:
+    struct Postings {
+        const char* begin;
+        uint32_t count;
+    };
+
+    bool postings(uint32_t trigram, Postings& list) const;
+    bool name(uint32_t id, std::string& out) const;
+
+    const char* m_offsets;
+    const char* m_names;
+    const char* m_table;
+    const char* m_postings;
+    const char* m_end;
+    uint32_t m_count;
+    uint32_t m_trigrams;
+    uint32_t m_namesSize;
+};
+
+}  // namespace cnf
+
+#endif /* TRIGRAM_INDEX_H_ */
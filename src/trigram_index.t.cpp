@@ -0,0 +1,84 @@
+#include "trigram_index.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "test_util.h"
+
+namespace {
+
+using cnf::test::random_word;
+
+// a small alphabet, so that trigrams are shared by many words
+const char LAST_LETTER = 'd';
+
+std::vector<std::string> find(const std::string& data,
+                              const std::string& part) {
+    const cnf::TrigramIndex index(data.data(), data.size());
+    std::vector<std::string> result;
+    index.find(part, result);
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("trigram_index::matches_scan") {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> length(1, 12);
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 2000; ++i) {
+        words.push_back(random_word(rng, length(rng), LAST_LETTER));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    const std::string data = cnf::TrigramIndex::build(words);
+    CHECK(cnf::TrigramIndex(data.data(), data.size()).size() == words.size());
+
+    for (int i = 0; i < 200; ++i) {
+        const std::string part = random_word(rng, 1 + i % 6, LAST_LETTER);
+        std::vector<std::string> expected;
+        for (const auto& word : words) {
+            if (word.find(part) != std::string::npos) {
+                expected.push_back(word);
+            }
+        }
+        CHECK(find(data, part) == expected);
+    }
+}
+
+TEST_CASE("trigram_index::commands") {
+    const std::string data = cnf::TrigramIndex::build(
+        {"egrep", "fgrep", "git", "grep", "pgrep", "zgrep", "zzz"});
+
+    CHECK(find(data, "grep") == std::vector<std::string>(
+                                    {"egrep", "fgrep", "grep", "pgrep",
+                                     "zgrep"}));
+    CHECK(find(data, "zgrep") == std::vector<std::string>({"zgrep"}));
+    CHECK(find(data, "gi") == std::vector<std::string>({"git"}));
+    // all trigrams are there, but not in this order
+    CHECK(find(data, "grepgrep").empty());
+    CHECK(find(data, "zzzz").empty());
+    CHECK(find(data, "xyz").empty());
+}
+
+TEST_CASE("trigram_index::invalid") {
+    const std::string data = cnf::TrigramIndex::build({"grep"});
+    CHECK(cnf::TrigramIndex(data.data(), data.size()).valid());
+
+    const std::string truncated = data.substr(0, 16);
+    CHECK(!cnf::TrigramIndex(truncated.data(), truncated.size()).valid());
+    CHECK(find(truncated, "grep").empty());
+
+    const std::string other = "python3 python2";
+    CHECK(!cnf::TrigramIndex(other.data(), other.size()).valid());
+
+    const std::string empty = cnf::TrigramIndex::build({});
+    CHECK(cnf::TrigramIndex(empty.data(), empty.size()).valid());
+    CHECK(find(empty, "grep").empty());
+}
@@ -0,0 +1,181 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/utsname.h>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "checksums.h"
+#include "config.h"
+
+namespace bf = boost::filesystem;
+using namespace cnf;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+static struct args_t {
+    string database_path;
+    string checksums;
+    int verbosity;
+} args;
+
+static const char* OPT_STRING = "d:s:vh?";
+
+static const struct option LONG_OPTS[] = {
+    {"database-path", required_argument, nullptr, 'd'},
+    {"checksums", required_argument, nullptr, 's'},
+    {"verbose", no_argument, nullptr, 'v'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, no_argument, nullptr, 0}};
+
+void usage() {
+    cout << format(translate("       *** %s %s ***                             "
+                             "                     \n")) %
+                PROGRAM_NAME % VERSION_LONG
+         << translate(
+                "Usage:                                                        "
+                "        \n")
+         << translate(
+                "   cnf-verify [ -d <path> ] [ -s <file> ] [ <catalog file>... "
+                "]       \n")
+         << translate(
+                "                                                              "
+                "        \n")
+         << translate(
+                "Options:                                                      "
+                "        \n")
+         << translate(
+                " --help            -? -h     Show this help and exit          "
+                "        \n")
+         << translate(
+                " --verbose         -v        Also list the intact catalogs    "
+                "        \n")
+         << translate(
+                "                                                              "
+                "        \n")
+         << format(translate(" --database-path   -d        Customize the "
+                             "database lookup path       \n"
+                             "                             default is %s       "
+                             "                     \n")) %
+                DATABASE_PATH
+         << translate(
+                " --checksums       -s        Checksum list to verify against, "
+                "default is\n"
+                "                             catalogs-<arch>-tdb.sums in the "
+                "database path\n")
+         << endl;
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    boost::locale::generator gen;
+    gen.add_messages_path(LC_MESSAGE_PATH);
+    gen.add_messages_domain(PROGRAM_NAME);
+    locale::global(gen(""));
+    cout.imbue(locale());
+
+    args.database_path = DATABASE_PATH;
+    args.verbosity = 0;
+
+    int opt(0), long_index(0);
+
+    opt = getopt_long(argc, argv, OPT_STRING, LONG_OPTS, &long_index);
+    while (opt != -1) {
+        switch (opt) {
+            case 'd':
+                args.database_path = optarg;
+                break;
+            case 's':
+                args.checksums = optarg;
+                break;
+            case 'v':
+                args.verbosity++;
+                break;
+            case 'h':
+            case '?':
+                usage();
+                break;
+            default:
+                break;
+        }
+        opt = getopt_long(argc, argv, OPT_STRING, LONG_OPTS, &long_index);
+    }
+
+    if (args.checksums.empty()) {
+        struct utsname name;
+        if (uname(&name) != 0) {
+            usage();
+        }
+        args.checksums =
+            checksums_path((bf::path(args.database_path) /
+                            (string("catalogs-") + name.machine + "-tdb"))
+                               .string());
+    }
+
+    vector<Checksum> checksums;
+    if (!read_checksums(args.checksums, checksums)) {
+        cerr << format(translate("Could not read checksums from %s")) %
+                    args.checksums
+             << endl;
+        return 1;
+    }
+
+    // restrict to the catalogs given on the command line
+    const vector<string> only(argv + optind, argv + argc);
+    for (const auto& file : only) {
+        if (none_of(checksums.begin(), checksums.end(),
+                    [&file](const Checksum& c) { return c.file == file; })) {
+            cerr << format(translate("%s: no checksum")) % file << endl;
+            return 1;
+        }
+    }
+
+    int rc = 0;
+    for (const auto& checksum : checksums) {
+        if (!only.empty() &&
+            find(only.begin(), only.end(), checksum.file) == only.end()) {
+            continue;
+        }
+        switch (verify_checksum(args.database_path, checksum)) {
+            case VERIFY_OK:
+                if (args.verbosity > 0) {
+                    cout << format(translate("%s: OK")) % checksum.file << endl;
+                }
+                break;
+            case VERIFY_MISMATCH:
+                cout << format(translate("%s: FAILED")) % checksum.file << endl;
+                rc = 1;
+                break;
+            case VERIFY_MISSING:
+                cout << format(translate("%s: MISSING")) % checksum.file
+                     << endl;
+                rc = 1;
+                break;
+        }
+    }
+    return rc;
+}
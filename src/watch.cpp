@@ -0,0 +1,289 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+#include <boost/locale.hpp>
+
+#include "custom_exceptions.h"
+#include "db.h"
+#include "manifest.h"
+#include "watch.h"
+
+namespace bf = boost::filesystem;
+using namespace std;
+using boost::format;
+using boost::locale::translate;
+
+namespace cnf {
+
+namespace {
+
+// written and closed (cp, repo-add), moved in (rsync, mv) or away, deleted
+const uint32_t EVENTS =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR;
+
+// how often run() checks whether it was stopped
+const int STOP_POLL_MS = 500;
+
+}  // namespace
+
+CatalogWatcher::CatalogWatcher(string database_path,
+                               const uint8_t verbosity,
+                               WatchOptions options)
+    : m_databasePath(move(database_path))
+    , m_verbosity(verbosity)
+    , m_options(move(options))
+    , m_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , m_overflow(false)
+    , m_stopped(false) {
+    if (m_fd < 0) {
+        throw DatabaseException(
+            IO_ERROR,
+            (format(translate("Could not watch package directories: %s")) %
+             strerror(errno))
+                .str());
+    }
+}
+
+CatalogWatcher::~CatalogWatcher() {
+    close(m_fd);
+}
+
+void CatalogWatcher::add(const string& catalog, const bf::path& dir) {
+    const int wd = inotify_add_watch(m_fd, dir.c_str(), EVENTS);
+    if (wd < 0) {
+        throw DatabaseException(IO_ERROR,
+                                (format(translate("Could not watch %s: %s")) %
+                                 dir.string() % strerror(errno))
+                                    .str());
+    }
+    // os/any is watched once, but belongs to a catalog per architecture
+    m_watches.emplace(wd, Watch{catalog, dir});
+}
+
+void CatalogWatcher::run() {
+    using namespace chrono;
+
+    while (!m_stopped) {
+        int timeout = STOP_POLL_MS;
+        if (!m_pending.empty() || m_overflow) {
+            const auto now = steady_clock::now();
+            const auto due =
+                min(m_last + milliseconds(m_options.debounce_ms),
+                    m_first + milliseconds(m_options.max_delay_ms));
+            if (now >= due) {
+                apply();
+                continue;
+            }
+            timeout = min<int>(
+                timeout, duration_cast<milliseconds>(due - now).count() + 1);
+        }
+        wait(timeout);
+    }
+}
+
+bool CatalogWatcher::wait(const int timeout_ms) {
+    pollfd pfd = {m_fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return false;
+    }
+
+    const bool idle = m_pending.empty() && !m_overflow;
+    bool seen = false;
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    ssize_t length = 0;
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (const char* ptr = buffer; ptr < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                m_overflow = true;
+                seen = true;
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            const bool present =
+                (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0;
+            const auto range = m_watches.equal_range(event->wd);
+            for (auto iter = range.first; iter != range.second; ++iter) {
+                m_pending[iter->second.catalog][iter->second.dir /
+                                                event->name] = present;
+                seen = true;
+            }
+        }
+    }
+
+    if (seen) {
+        m_last = chrono::steady_clock::now();
+        if (idle) {
+            m_first = m_last;
+        }
+    }
+    return seen;
+}
+
+size_t CatalogWatcher::apply() {
+    set<string> full;
+    if (m_overflow) {
+        m_overflow = false;
+        full = resync();
+    }
+
+    map<string, map<bf::path, bool>> pending;
+    pending.swap(m_pending);
+
+    size_t changed = 0;
+    for (const auto& elem : pending) {
+        const size_t catalog_changed =
+            apply(elem.first, elem.second, full.count(elem.first) != 0);
+#ifdef WITH_ZSTD
+        if (catalog_changed > 0 && m_options.compress) {
+            publish_pack(m_databasePath, elem.first, m_verbosity);
+        }
+#endif
+        changed += catalog_changed;
+    }
+    // last, the packs and checksums change the directory as well
+    if (changed > 0) {
+        update_checksums(m_databasePath);
+        Manifest::update(m_databasePath);
+    }
+    return changed;
+}
+
+size_t CatalogWatcher::apply(const string& catalog,
+                             const map<bf::path, bool>& changes,
+                             const bool full) {
+    size_t changed = 0;
+    try {
+        shared_ptr<Database> d = getDatabase(catalog, false, m_databasePath);
+        d->beginTransaction();
+
+        // drop first: an upgrade may add the new file before the old one
+        // is deleted
+        set<string> present;
+        for (const auto& change : changes) {
+            try {
+                const Package p = package_from_path(change.first);
+                if (change.second) {
+                    present.insert(p.name());
+                } else if (d->hasPackage(p) && d->removePackage(p.name())) {
+                    // the indexed version is the one that is gone
+                    ++changed;
+                }
+            } catch (const InvalidArgumentException&) {
+                // not a package, e.g. a temporary file of rsync
+            }
+        }
+        if (full) {
+            // catalogs written before the package index lack it or have it
+            // only for the packages updated since
+            vector<string> names;
+            d->scanPackages(names);
+            for (const auto& name : names) {
+                if (present.count(name) == 0 && d->removePackage(name)) {
+                    ++changed;
+                }
+            }
+        }
+
+        for (const auto& change : changes) {
+            if (!change.second) {
+                continue;
+            }
+            try {
+                const Package indexed(change.first, true);
+                if (d->hasPackage(indexed)) {
+                    continue;
+                }
+                // read now, a broken file must not be indexed without files
+                const Package p(change.first, false,
+                                m_options.file_lists.get());
+                // the owners of another version stay behind otherwise, its
+                // file may only be removed with a later batch
+                d->removePackage(indexed.name());
+                d->storePackage(p);
+                ++changed;
+                if (m_verbosity > 0) {
+                    cout << format(translate("%s: indexed %s")) % catalog %
+                                change.first.filename().string()
+                         << endl;
+                }
+            } catch (const InvalidArgumentException& e) {
+                if (m_verbosity > 0) {
+                    cout << format(translate("skipping (%s)")) % e.what()
+                         << endl;
+                }
+            }
+        }
+
+        d->commitTransaction();
+    } catch (const DatabaseException& e) {
+        cerr << e.what() << endl;
+        return 0;
+    }
+
+    if (changed > 0) {
+        if (m_verbosity > 0) {
+            cout << format(translate("%s: %d packages updated")) % catalog %
+                        changed
+                 << endl;
+        }
+    }
+    return changed;
+}
+
+set<string> CatalogWatcher::resync() {
+    using dirIter = bf::directory_iterator;
+
+    set<string> catalogs;
+    for (const auto& elem : m_watches) {
+        const Watch& watch = elem.second;
+        auto& files = m_pending[watch.catalog];
+        boost::system::error_code ec;
+        for (dirIter iter = dirIter(watch.dir, ec); !ec && iter != dirIter();
+             iter.increment(ec)) {
+            files[*iter] = true;
+        }
+        catalogs.insert(watch.catalog);
+    }
+    return catalogs;
+}
+
+}  // namespace cnf
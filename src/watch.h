@@ -0,0 +1,109 @@
+/*
+    This file is part of command-not-found.
+    Copyright (C) 2011 Matthias Maennich <matthias@maennich.net>
+
+    command-not-found is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    command-not-found is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with command-not-found.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace cnf {
+
+class FileListCache;
+
+struct WatchOptions {
+    // changes are applied once no event arrived for this long...
+    unsigned debounce_ms = 2000;
+    // ...but at the latest this long after the first one
+    unsigned max_delay_ms = 30000;
+    std::shared_ptr<FileListCache> file_lists;
+    // republish the packs of changed catalogs, see publish_pack()
+    bool compress = false;
+};
+
+// Keeps catalogs up to date with their package directories through inotify.
+// Packages written (closed after writing) or moved into a directory are
+// indexed, those deleted or moved away are dropped, a burst of changes as
+// repo-add makes them is applied at once. Every catalog is updated in one
+// transaction, so lookups never see half of a batch.
+class CatalogWatcher {
+public:
+    // throws DatabaseException if inotify is not available
+    CatalogWatcher(std::string database_path,
+                   uint8_t verbosity,
+                   WatchOptions options = WatchOptions());
+    CatalogWatcher(const CatalogWatcher&) = delete;
+    CatalogWatcher& operator=(const CatalogWatcher&) = delete;
+    ~CatalogWatcher();
+
+    // throws DatabaseException if dir can not be watched
+    void add(const std::string& catalog, const boost::filesystem::path& dir);
+
+    // Applies the changes as they come, until stop() is called.
+    void run();
+    // may be called from any thread
+    void stop() { m_stopped = true; }
+
+    // Waits up to timeout_ms for events and records them. Returns false if
+    // none arrived.
+    bool wait(int timeout_ms);
+    // Applies the recorded changes and returns the number of packages that
+    // were indexed or dropped.
+    size_t apply();
+
+private:
+    struct Watch {
+        std::string catalog;
+        boost::filesystem::path dir;
+    };
+
+    // full: the changes list every file of the catalog, drop all others
+    size_t apply(const std::string& catalog,
+                 const std::map<boost::filesystem::path, bool>& changes,
+                 bool full);
+    // After the kernel dropped events: records all files of the watched
+    // directories and returns the catalogs to compare fully.
+    std::set<std::string> resync();
+
+    const std::string m_databasePath;
+    const uint8_t m_verbosity;
+    const WatchOptions m_options;
+    int m_fd;
+    std::multimap<int, Watch> m_watches;
+    // per catalog, whether a file is there (true) or gone since
+    std::map<std::string, std::map<boost::filesystem::path, bool>> m_pending;
+    bool m_overflow;
+    std::chrono::steady_clock::time_point m_first;
+    std::chrono::steady_clock::time_point m_last;
+    std::atomic<bool> m_stopped;
+};
+
+}  // namespace cnf
+
+#endif /* WATCH_H_ */
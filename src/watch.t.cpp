@@ -0,0 +1,113 @@
+#include "watch.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <catch2/catch.hpp>
+
+#include "db_tdb.h"
+#include "manifest.h"
+#include "test_util.h"
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+using cnf::test::TempDir;
+
+bf::path package(const bf::path& dir,
+                 const std::string& name,
+                 const std::string& version,
+                 const std::vector<std::string>& commands) {
+    const bf::path path =
+        dir / (name + "-" + version + "-1-x86_64.pkg.tar.gz");
+    std::vector<std::string> entries;
+    for (const auto& command : commands) {
+        entries.push_back("usr/bin/" + command);
+    }
+    cnf::test::write_package(path, entries);
+    return path;
+}
+
+// waits for the first event and collects the burst that follows
+bool settle(cnf::CatalogWatcher& watcher) {
+    bool seen = false;
+    for (int i = 0; i < 50 && !seen; ++i) {
+        seen = watcher.wait(100);
+    }
+    while (watcher.wait(50)) {
+    }
+    return seen;
+}
+
+std::vector<cnf::Package> lookup(const bf::path& db,
+                                 const std::string& command) {
+    cnf::TdbDatabase catalog("core-x86_64", true, db.string());
+    std::vector<cnf::Package> result;
+    catalog.getPackages(command, result);
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("watch::add_upgrade_remove") {
+    TempDir dir;
+    const bf::path packages = dir.path / "packages";
+    const bf::path staging = dir.path / "staging";
+    const bf::path db = dir.path / "db";
+    for (const auto& path : {packages, staging, db}) {
+        bf::create_directories(path);
+    }
+
+    // published, the watcher keeps its checksums up to date
+    std::ofstream((db / "catalogs-x86_64-tdb").string()) << "core-x86_64.tdb\n";
+
+    cnf::CatalogWatcher watcher(db.string(), 0);
+    watcher.add("core-x86_64", packages);
+
+    // written in place
+    const bf::path old = package(packages, "vim", "1.0", {"vim", "vimdiff"});
+    package(packages, "vim-notes", "1.0", {});
+    REQUIRE(settle(watcher));
+    CHECK(watcher.apply() == 2);
+    REQUIRE(lookup(db, "vimdiff").size() == 1);
+    // the checksums are written before the manifest
+    CHECK(cnf::Manifest().read(db.string()));
+
+    // moved in before the old version is removed, like repo-add does
+    const bf::path next = package(staging, "vim", "2.0", {"vim"});
+    bf::rename(next, packages / next.filename());
+    bf::remove(old);
+    REQUIRE(settle(watcher));
+    CHECK(watcher.apply() == 2);
+    const auto found = lookup(db, "vim");
+    REQUIRE(found.size() == 1);
+    CHECK(found[0].version() == "2.0");
+    CHECK(lookup(db, "vimdiff").empty());
+
+    // the old version is still there when the new one is applied
+    const bf::path third = package(staging, "vim", "3.0", {"ex"});
+    bf::rename(third, packages / third.filename());
+    REQUIRE(settle(watcher));
+    CHECK(watcher.apply() == 1);
+    REQUIRE(lookup(db, "ex").size() == 1);
+    CHECK(lookup(db, "vim").empty());
+    bf::remove(packages / next.filename());
+    REQUIRE(settle(watcher));
+    CHECK(watcher.apply() == 0);
+    CHECK(lookup(db, "ex").size() == 1);
+
+    bf::remove(packages / third.filename());
+    // not a package, ignored
+    package(packages, "README", "", {});
+    REQUIRE(settle(watcher));
+    CHECK(watcher.apply() == 1);
+    CHECK(lookup(db, "vim").empty());
+
+    std::vector<std::string> commands;
+    cnf::TdbDatabase catalog("core-x86_64", true, db.string());
+    CHECK(catalog.getCommands(commands));
+    CHECK(commands.empty());
+}